@@ -9,26 +9,486 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
+#include <set>
+#include <map>
+#include <algorithm>
+#include <tuple>
+#include <type_traits>
+#include <atomic>
 #include <sstream>
 #include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#ifdef VexV5
+#include "vex.h"
+#else
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <functional>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
 
 // Exception codes:
 // VFS_INIT_FAILED
 // FILE_NOT_FOUND
 // FILE_ALREADY_EXISTS
 // CANNOT_OPEN_FILE
+// CORRUPT_FILE
+// SCHEMA_MISMATCH
+
+/**
+ * @brief Powers of 10 that are exactly representable as a double
+ *
+ */
+const double POWERS_OF_10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                               1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+/**
+ * @brief Convert an unsigned integer to a string
+ *
+ * @param value value to convert
+ * @return std::string
+ */
+std::string to_string(unsigned long long value) {
+    char buffer[20];
+    int length = 0;
+    do {
+        buffer[sizeof(buffer) - ++length] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+    return std::string(buffer + sizeof(buffer) - length, length);
+}
+
+/**
+ * @brief Convert an integer to a string
+ *
+ * @param value value to convert
+ * @return std::string
+ */
+std::string to_string(long long value) {
+    if (value < 0) return "-" + to_string(0ULL - (unsigned long long)value);
+    return to_string((unsigned long long)value);
+}
+
+std::string to_string(int value) { return to_string((long long)value); }
+
+std::string to_string(long value) { return to_string((long long)value); }
+
+std::string to_string(unsigned int value) { return to_string((unsigned long long)value); }
+
+std::string to_string(unsigned long value) { return to_string((unsigned long long)value); }
+
+/**
+ * @brief A floating point number with a 64 bit significand, used by the Grisu2 algorithm
+ *
+ * @param f the significand
+ * @param e the binary exponent
+ */
+typedef struct lemlibDiyFp {
+        unsigned long long f;
+        int e;
+} lemlibDiyFp;
+
+/**
+ * @brief Multiply two numbers, rounding the significand of the result to 64 bits
+ *
+ * @param x the first number
+ * @param y the second number
+ * @return lemlibDiyFp the product
+ */
+lemlibDiyFp multiplyDiyFp(lemlibDiyFp x, lemlibDiyFp y) {
+    unsigned long long a = x.f >> 32, b = x.f & 0xffffffffULL, c = y.f >> 32, d = y.f & 0xffffffffULL;
+    unsigned long long bd = b * d, ad = a * d, bc = b * c;
+    unsigned long long middle = (bd >> 32) + (ad & 0xffffffffULL) + (bc & 0xffffffffULL) + (1ULL << 31);
+    lemlibDiyFp result = {a * c + (ad >> 32) + (bc >> 32) + (middle >> 32), x.e + y.e + 64};
+    return result;
+}
+
+/**
+ * @brief Shift a number left until the highest bit of its significand is set
+ *
+ * @param x the number to normalize
+ * @return lemlibDiyFp the normalized number
+ */
+lemlibDiyFp normalizeDiyFp(lemlibDiyFp x) {
+    while (!(x.f >> 63)) {
+        x.f <<= 1;
+        x.e--;
+    }
+    return x;
+}
+
+/**
+ * @brief Normalized powers of 10 from 10^-300 to 10^324 in steps of 10^8, as significand, binary exponent
+ * and decimal exponent
+ *
+ */
+const struct {
+        unsigned long long f;
+        int e;
+        int k;
+} CACHED_POWERS[] = {
+    {0xAB70FE17C79AC6CAULL, -1060, -300},
+    {0xFF77B1FCBEBCDC4FULL, -1034, -292},
+    {0xBE5691EF416BD60CULL, -1007, -284},
+    {0x8DD01FAD907FFC3CULL, -980, -276},
+    {0xD3515C2831559A83ULL, -954, -268},
+    {0x9D71AC8FADA6C9B5ULL, -927, -260},
+    {0xEA9C227723EE8BCBULL, -901, -252},
+    {0xAECC49914078536DULL, -874, -244},
+    {0x823C12795DB6CE57ULL, -847, -236},
+    {0xC21094364DFB5637ULL, -821, -228},
+    {0x9096EA6F3848984FULL, -794, -220},
+    {0xD77485CB25823AC7ULL, -768, -212},
+    {0xA086CFCD97BF97F4ULL, -741, -204},
+    {0xEF340A98172AACE5ULL, -715, -196},
+    {0xB23867FB2A35B28EULL, -688, -188},
+    {0x84C8D4DFD2C63F3BULL, -661, -180},
+    {0xC5DD44271AD3CDBAULL, -635, -172},
+    {0x936B9FCEBB25C996ULL, -608, -164},
+    {0xDBAC6C247D62A584ULL, -582, -156},
+    {0xA3AB66580D5FDAF6ULL, -555, -148},
+    {0xF3E2F893DEC3F126ULL, -529, -140},
+    {0xB5B5ADA8AAFF80B8ULL, -502, -132},
+    {0x87625F056C7C4A8BULL, -475, -124},
+    {0xC9BCFF6034C13053ULL, -449, -116},
+    {0x964E858C91BA2655ULL, -422, -108},
+    {0xDFF9772470297EBDULL, -396, -100},
+    {0xA6DFBD9FB8E5B88FULL, -369, -92},
+    {0xF8A95FCF88747D94ULL, -343, -84},
+    {0xB94470938FA89BCFULL, -316, -76},
+    {0x8A08F0F8BF0F156BULL, -289, -68},
+    {0xCDB02555653131B6ULL, -263, -60},
+    {0x993FE2C6D07B7FACULL, -236, -52},
+    {0xE45C10C42A2B3B06ULL, -210, -44},
+    {0xAA242499697392D3ULL, -183, -36},
+    {0xFD87B5F28300CA0EULL, -157, -28},
+    {0xBCE5086492111AEBULL, -130, -20},
+    {0x8CBCCC096F5088CCULL, -103, -12},
+    {0xD1B71758E219652CULL, -77, -4},
+    {0x9C40000000000000ULL, -50, 4},
+    {0xE8D4A51000000000ULL, -24, 12},
+    {0xAD78EBC5AC620000ULL, 3, 20},
+    {0x813F3978F8940984ULL, 30, 28},
+    {0xC097CE7BC90715B3ULL, 56, 36},
+    {0x8F7E32CE7BEA5C70ULL, 83, 44},
+    {0xD5D238A4ABE98068ULL, 109, 52},
+    {0x9F4F2726179A2245ULL, 136, 60},
+    {0xED63A231D4C4FB27ULL, 162, 68},
+    {0xB0DE65388CC8ADA8ULL, 189, 76},
+    {0x83C7088E1AAB65DBULL, 216, 84},
+    {0xC45D1DF942711D9AULL, 242, 92},
+    {0x924D692CA61BE758ULL, 269, 100},
+    {0xDA01EE641A708DEAULL, 295, 108},
+    {0xA26DA3999AEF774AULL, 322, 116},
+    {0xF209787BB47D6B85ULL, 348, 124},
+    {0xB454E4A179DD1877ULL, 375, 132},
+    {0x865B86925B9BC5C2ULL, 402, 140},
+    {0xC83553C5C8965D3DULL, 428, 148},
+    {0x952AB45CFA97A0B3ULL, 455, 156},
+    {0xDE469FBD99A05FE3ULL, 481, 164},
+    {0xA59BC234DB398C25ULL, 508, 172},
+    {0xF6C69A72A3989F5CULL, 534, 180},
+    {0xB7DCBF5354E9BECEULL, 561, 188},
+    {0x88FCF317F22241E2ULL, 588, 196},
+    {0xCC20CE9BD35C78A5ULL, 614, 204},
+    {0x98165AF37B2153DFULL, 641, 212},
+    {0xE2A0B5DC971F303AULL, 667, 220},
+    {0xA8D9D1535CE3B396ULL, 694, 228},
+    {0xFB9B7CD9A4A7443CULL, 720, 236},
+    {0xBB764C4CA7A44410ULL, 747, 244},
+    {0x8BAB8EEFB6409C1AULL, 774, 252},
+    {0xD01FEF10A657842CULL, 800, 260},
+    {0x9B10A4E5E9913129ULL, 827, 268},
+    {0xE7109BFBA19C0C9DULL, 853, 276},
+    {0xAC2820D9623BF429ULL, 880, 284},
+    {0x80444B5E7AA7CF85ULL, 907, 292},
+    {0xBF21E44003ACDD2DULL, 933, 300},
+    {0x8E679C2F5E44FF8FULL, 960, 308},
+    {0xD433179D9C8CB841ULL, 986, 316},
+    {0x9E19DB92B4E31BA9ULL, 1013, 324}};
+
+/**
+ * @brief Generate the shortest digits of a positive number with the Grisu2 algorithm
+ *
+ * The digits always read back as the same number, and are the shortest such digits for nearly every number.
+ *
+ * @param significand the significand of the number, including the hidden bit
+ * @param exponent the binary exponent of the number
+ * @param lowerCloser whether the next smaller number is closer than the next larger one
+ * @param digits set to the digits
+ * @return int the decimal exponent of the last digit
+ */
+int grisu2(unsigned long long significand, int exponent, bool lowerCloser, std::string& digits) {
+    // the boundaries halfway to the neighbouring numbers
+    lemlibDiyFp plus = {2 * significand + 1, exponent - 1};
+    lemlibDiyFp minus = {lowerCloser ? 4 * significand - 1 : 2 * significand - 1, lowerCloser ? exponent - 2 : exponent - 1};
+    plus = normalizeDiyFp(plus);
+    minus.f <<= minus.e - plus.e;
+    minus.e = plus.e;
+    lemlibDiyFp value = {significand, exponent};
+    value = normalizeDiyFp(value);
+    // scale by a cached power of 10 so the exponent is between -60 and -32
+    int f = -61 - plus.e;
+    int k = (f * 78913) / (1 << 18) + (f > 0);
+    int cached = (300 + k + 7) / 8;
+    lemlibDiyFp power = {CACHED_POWERS[cached].f, CACHED_POWERS[cached].e};
+    lemlibDiyFp w = multiplyDiyFp(value, power);
+    lemlibDiyFp high = multiplyDiyFp(plus, power);
+    lemlibDiyFp low = multiplyDiyFp(minus, power);
+    high.f--;
+    low.f++;
+    int decimalExponent = -CACHED_POWERS[cached].k;
+
+    unsigned long long delta = high.f - low.f;
+    unsigned long long distance = high.f - w.f;
+    int shift = -high.e;
+    unsigned long long one = 1ULL << shift;
+    unsigned long integral = (unsigned long)(high.f >> shift);
+    unsigned long long fraction = high.f & (one - 1);
+    // generate the digits of the integral part
+    unsigned long pow10 = 1;
+    int count = 1;
+    while (count < 10 && integral >= pow10 * 10) {
+        pow10 *= 10;
+        count++;
+    }
+    unsigned long long rest;
+    unsigned long long unit;
+    for (;;) {
+        if (count == 0) {
+            // generate the digits of the fractional part
+            int fractionDigits = 0;
+            do {
+                fraction *= 10;
+                digits += (char)('0' + (fraction >> shift));
+                fraction &= one - 1;
+                fractionDigits++;
+                delta *= 10;
+                distance *= 10;
+            } while (fraction > delta);
+            decimalExponent -= fractionDigits;
+            rest = fraction;
+            unit = one;
+            break;
+        }
+        digits += (char)('0' + integral / pow10);
+        integral %= pow10;
+        count--;
+        rest = ((unsigned long long)integral << shift) + fraction;
+        if (rest <= delta) {
+            decimalExponent += count;
+            unit = (unsigned long long)pow10 << shift;
+            break;
+        }
+        pow10 /= 10;
+    }
+    // move the last digit closer to the exact value while it stays within the boundaries
+    while (rest < distance && delta - rest >= unit &&
+           (rest + unit < distance || distance - rest > rest + unit - distance)) {
+        digits[digits.length() - 1]--;
+        rest += unit;
+    }
+    return decimalExponent;
+}
+
+/**
+ * @brief Format digits with a decimal exponent
+ *
+ * Numbers from 1e-5 up to 1e17 are written with a decimal point, others with an exponent.
+ *
+ * @param negative whether to add a minus sign
+ * @param digits the digits of the number
+ * @param exponent the decimal exponent of the last digit
+ * @return std::string the formatted number
+ */
+std::string formatDecimal(bool negative, std::string digits, int exponent) {
+    int point = (int)digits.length() + exponent;
+    if (exponent >= 0 && point <= 17) digits.append(exponent, '0');
+    else if (point > 0 && point <= 17) digits.insert(point, ".");
+    else if (point > -5 && point <= 0) digits.insert(0, "0." + std::string(-point, '0'));
+    else {
+        if (digits.length() > 1) digits.insert(1, ".");
+        digits += "e" + std::string(point - 1 < 0 ? "-" : "+") + to_string(abs(point - 1));
+    }
+    return negative ? "-" + digits : digits;
+}
 
 /**
- * @brief Convert a value to a string
+ * @brief Convert a double to the shortest string that reads back as the same double
+ *
+ * Unlike streams, this does not depend on the locale.
+ *
+ * @param value value to convert
+ * @return std::string
+ */
+std::string to_string(double value) {
+    if (value != value) return "nan";
+    bool negative = signbit(value);
+    if (fabs(value) == HUGE_VAL) return negative ? "-inf" : "inf";
+    if (value == 0) return negative ? "-0" : "0";
+    unsigned long long bits;
+    memcpy(&bits, &value, sizeof(bits));
+    unsigned long long significand = bits & ((1ULL << 52) - 1);
+    int exponent = (int)((bits >> 52) & 0x7ff);
+    std::string digits;
+    // subnormal numbers have no hidden bit
+    if (exponent == 0) exponent = grisu2(significand, -1074, false, digits);
+    else exponent = grisu2(significand | (1ULL << 52), exponent - 1075, significand == 0 && exponent > 1, digits);
+    return formatDecimal(negative, digits, exponent);
+}
+
+/**
+ * @brief Convert a float to the shortest string that reads back as the same float
  *
- * @tparam T
  * @param value value to convert
  * @return std::string
  */
-template <typename T> std::string to_string(T value) {
-    std::ostringstream os;
-    os << value;
-    return os.str();
+std::string to_string(float value) {
+    if (value != value) return "nan";
+    bool negative = signbit(value);
+    if (fabsf(value) == HUGE_VALF) return negative ? "-inf" : "inf";
+    if (value == 0) return negative ? "-0" : "0";
+    unsigned long bits = 0;
+    memcpy(&bits, &value, sizeof(value));
+    unsigned long significand = bits & ((1UL << 23) - 1);
+    int exponent = (int)((bits >> 23) & 0xff);
+    std::string digits;
+    // subnormal numbers have no hidden bit
+    if (exponent == 0) exponent = grisu2(significand, -149, false, digits);
+    else exponent = grisu2(significand | (1UL << 23), exponent - 150, significand == 0 && exponent > 1, digits);
+    return formatDecimal(negative, digits, exponent);
+}
+
+/**
+ * @brief The digits of a decimal number, as read by scanDecimal
+ *
+ * @param negative whether the number has a minus sign
+ * @param digits the significant digits
+ * @param exponent the power of 10 the digits are multiplied by
+ * @param exact whether every significant digit fit in digits
+ */
+typedef struct lemlibDecimal {
+        bool negative;
+        unsigned long long digits;
+        int exponent;
+        bool exact;
+} lemlibDecimal;
+
+/**
+ * @brief Read the digits of a decimal number
+ *
+ * @param str the string to read
+ * @param end set to the first character after the number, or str if there is no number
+ * @return lemlibDecimal the digits of the number
+ */
+lemlibDecimal scanDecimal(const char* str, const char** end) {
+    lemlibDecimal decimal = {false, 0, 0, true};
+    const char* pos = str;
+    while (*pos == ' ' || *pos == '\t') pos++;
+    if (*pos == '-' || *pos == '+') decimal.negative = *pos++ == '-';
+    bool found = false;
+    bool point = false;
+    for (;; pos++) {
+        if (*pos == '.' && !point) {
+            point = true;
+            continue;
+        }
+        if (*pos < '0' || *pos > '9') break;
+        found = true;
+        if (decimal.digits < 100000000000000000ULL) {
+            decimal.digits = decimal.digits * 10 + (*pos - '0');
+            if (point) decimal.exponent--;
+        } else {
+            // digits that do not fit are only kept track of
+            if (*pos != '0') decimal.exact = false;
+            if (!point) decimal.exponent++;
+        }
+    }
+    if (!found) {
+        *end = str;
+        return decimal;
+    }
+    if (*pos == 'e' || *pos == 'E') {
+        const char* exponent = pos + 1;
+        bool negative = false;
+        if (*exponent == '-' || *exponent == '+') negative = *exponent++ == '-';
+        if (*exponent >= '0' && *exponent <= '9') {
+            int value = 0;
+            for (; *exponent >= '0' && *exponent <= '9'; exponent++) {
+                if (value < 10000) value = value * 10 + (*exponent - '0');
+            }
+            decimal.exponent += negative ? -value : value;
+            pos = exponent;
+        }
+    }
+    *end = pos;
+    return decimal;
+}
+
+/**
+ * @brief Convert a string to a double
+ *
+ * If the digits and the power of 10 are exact doubles, a single multiplication or division gives
+ * the correctly rounded result. Other numbers, and special values like inf, fall back to strtod.
+ *
+ * @param str the string to convert
+ * @param end set to the first character after the number, if not NULL
+ * @return double the number, or 0 if there is none
+ */
+double parseDouble(const char* str, const char** end = NULL) {
+    const char* stop;
+    lemlibDecimal decimal = scanDecimal(str, &stop);
+    if (stop != str && decimal.exact && decimal.digits < 9007199254740992ULL && decimal.exponent >= -22 &&
+        decimal.exponent <= 22) {
+        if (end != NULL) *end = stop;
+        double value = (double)decimal.digits;
+        if (decimal.exponent < 0) value /= POWERS_OF_10[-decimal.exponent];
+        else value *= POWERS_OF_10[decimal.exponent];
+        return decimal.negative ? -value : value;
+    }
+    char* fallback;
+    double value = strtod(str, &fallback);
+    if (end != NULL) *end = fallback;
+    return value;
+}
+
+/**
+ * @brief Convert a string to a float
+ *
+ * @param str the string to convert
+ * @param end set to the first character after the number, if not NULL
+ * @return float the number, or 0 if there is none
+ */
+float parseFloat(const char* str, const char** end = NULL) {
+    const char* stop;
+    lemlibDecimal decimal = scanDecimal(str, &stop);
+    if (stop != str && decimal.exact && decimal.digits <= 16777216ULL && decimal.exponent >= -10 &&
+        decimal.exponent <= 10) {
+        if (end != NULL) *end = stop;
+        float value = (float)decimal.digits;
+        if (decimal.exponent < 0) value /= (float)POWERS_OF_10[-decimal.exponent];
+        else value *= (float)POWERS_OF_10[decimal.exponent];
+        return decimal.negative ? -value : value;
+    }
+    char* fallback;
+    float value = strtof(str, &fallback);
+    if (end != NULL) *end = fallback;
+    return value;
 }
 
 typedef struct VFS_INIT_FAILED {};
@@ -47,338 +507,4951 @@ typedef struct CANNOT_OPEN_FILE {};
 
 CANNOT_OPEN_FILE cannotOpenFile;
 
+typedef struct CORRUPT_FILE {};
+
+CORRUPT_FILE corruptFile;
+
+typedef struct SCHEMA_MISMATCH {};
+
+SCHEMA_MISMATCH schemaMismatch;
+
 /**
  * @brief Structure for an entry in the index file
  *
  * @param name the name of the file
  * @param sector the sector the file is stored in
+ * @param size the size of the file in bytes
+ * @param created the time the file was created, in seconds since the epoch
+ * @param modified the time the file was last written, in seconds since the epoch
+ * @param flags file flags, such as FILE_FLAG_COMPRESSED
+ * @param hash the hash of the contents of the file, or 0 if it is not known
+ * @param data the contents of a file with FILE_FLAG_INLINE, which has no sector
  */
 typedef struct lemlibFile {
         std::string name;
         std::string sector;
+        unsigned long size;
+        unsigned long created;
+        unsigned long modified;
+        unsigned long flags;
+        unsigned long long hash;
+        std::string data;
 } lemlibFile;
 
 /**
- * @brief Initialize the file system
+ * @brief Flag for files whose sector is compressed
  *
  */
-void initVFS() {
-    // Check if the index file exists
-    std::ifstream indexFile;
-    indexFile.open("index.txt");
-    // If the index file does not exist, create it
-    if (!indexFile.is_open()) {
-        std::ofstream indexFile;
-        indexFile.open("index.txt");
-        // throw an exception if the index file could not be created
-        if (!indexFile.is_open()) throw vfsInitFailed;
-        indexFile.close();
+const unsigned long FILE_FLAG_COMPRESSED = 1 << 0;
+
+/**
+ * @brief Flag for ring files, whose sector is written in place and never deduplicated
+ *
+ */
+const unsigned long FILE_FLAG_RING = 1 << 1;
+
+/**
+ * @brief Flag for files whose contents are stored in their index entry instead of a sector
+ *
+ */
+const unsigned long FILE_FLAG_INLINE = 1 << 2;
+
+/**
+ * @brief Files up to this size in bytes are stored in their index entry, so reading them does not open a sector
+ *
+ */
+const unsigned long INLINE_FILE_SIZE = 32;
+
+/**
+ * @brief Flag for files whose sector has space reserved after their contents
+ *
+ * The sector is larger than the file, so it is written in place instead of being truncated, and
+ * only the size in the index tells where the contents end.
+ */
+const unsigned long FILE_FLAG_PREALLOCATED = 1 << 3;
+
+/**
+ * @brief Flag for files whose sector may also be used by files in other top-level directories
+ *
+ * The references to the sector of any other file are all in its own part of the index and the
+ * snapshots, so only these files need every part of the index to count them.
+ */
+const unsigned long FILE_FLAG_SHARED = 1 << 4;
+
+/**
+ * @brief Incremented whenever a sector becomes shared by another file or a snapshot, a snapshot is
+ * restored, or a sector is freed
+ *
+ * Files that keep their sector open check this to know when they have to reopen or copy their sector,
+ * and stop writing to a sector that was freed and may be reused by another file.
+ */
+unsigned long sharingGeneration = 0;
+
+/**
+ * @brief Whether files with identical contents share a sector
+ *
+ */
+bool deduplicate = false;
+
+/**
+ * @brief Hash data with 64 bit FNV-1a
+ *
+ * @param data the data to hash
+ * @param length the length of the data
+ * @param hash the hash of the data before this data, to hash data that is appended
+ * @return unsigned long long the hash, which is never 0
+ */
+unsigned long long hashData(const char* data, size_t length, unsigned long long hash = 14695981039346656037ULL) {
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ULL;
     }
+    // 0 is reserved for unknown hashes
+    return hash == 0 ? 1 : hash;
 }
 
 /**
- * @brief Read the index file
+ * @brief Convert a hash to a hexadecimal string
  *
- * @return std::vector<lemlibFile> contents of the index file
+ * @param hash the hash to convert
+ * @return std::string the hash as 16 hexadecimal digits
  */
-std::vector<lemlibFile> readFileIndex() {
-    // Initialize the vector
-    std::vector<lemlibFile> index;
-    // Open the index file
-    std::ifstream indexFile;
-    indexFile.open("index.txt");
-    // throw an exception if the index file could not be opened
-    if (!indexFile.is_open()) throw cannotOpenFile;
-    // iterate through the index file
-    for (std::string line; std::getline(indexFile, line);) {
-        // split the line into the name and the sector
-        // the number after the last backslash is the sector
-        std::string name = line.substr(0, line.find_last_of("/"));
-        std::string sector = line.substr(line.find_last_of("/") + 1);
-        // add the file to the index
-        index.push_back({name, sector});
+std::string hashToString(unsigned long long hash) {
+    const char* digits = "0123456789abcdef";
+    std::string result(16, '0');
+    for (int i = 15; i >= 0; i--) {
+        result[i] = digits[hash & 0xf];
+        hash >>= 4;
     }
-    return index;
+    return result;
 }
 
 /**
- * @brief Get the Sector object
+ * @brief Parse a hexadecimal hash
  *
- * @param path the path of the virtual file
- * @return const char* the sector the file is stored in, or null if the file is not found
+ * @param str the hexadecimal digits
+ * @param end set to the first character after the hash
+ * @return unsigned long long the hash
  */
-const char* getFileSector(const char* path) {
-    std::string filePath = path;
-    // if the path does not start with a slash, add one
-    if (filePath.find("/") != 0) filePath = "/" + filePath;
-    // Read the index file
-    std::vector<lemlibFile> index = readFileIndex();
-    // Iterate through the index
-    for (const lemlibFile& file : index) {
-        // Check if the name matches
-        if (file.name == filePath) return file.sector.c_str();
+unsigned long long parseHash(const char* str, const char** end) {
+    unsigned long long hash = 0;
+    for (;; str++) {
+        if (*str >= '0' && *str <= '9') hash = (hash << 4) | (*str - '0');
+        else if (*str >= 'a' && *str <= 'f') hash = (hash << 4) | (*str - 'a' + 10);
+        else break;
     }
-    // Return null if the file is not found
-    return NULL;
+    *end = str;
+    return hash;
 }
 
 /**
- * @brief Get the Sector object
+ * @brief Get the current time with a high resolution, for benchmarks
  *
- * @param path the path of the virtual file
- * @return const char* the sector the file is stored in, or null if the file is not found
+ * @return unsigned long long the time in microseconds
  */
-const char* getFileSector(std::string path) { return getFileSector(path.c_str()); }
+unsigned long long microseconds() {
+#ifdef VexV5
+    return vexSystemHighResTimeGet();
+#else
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+}
 
 /**
- * @brief List all the files and folders in a directory
+ * @brief Pause the current task
  *
- * @param dir the directory to list
- * @return std::vector <std::string> a vector of all the files and folders in the directory
+ * @param time the time to sleep in milliseconds
  */
-std::vector<std::string> listDirectory(const char* dir, bool recursive = false) {
-    std::string directory = dir;
-    // if the path does not start with a slash, add one
-    if (directory.find("/") != 0) directory = "/" + directory;
-    // Initialize the vector
-    std::vector<std::string> files;
-    // Read the index file
-    std::vector<lemlibFile> index = readFileIndex();
-    // Iterate through the index
-    for (const lemlibFile& line : index) {
-        // Check if the name starts with the directory
-        if (line.name.find(directory) == std::string::npos) continue;
-        // remove the directory from the name
-        std::string name = line.name.substr(line.name.find(directory) + strlen(directory.c_str()));
-        // if there is a remaining slash, a directory is found
-        if (name.find("/") != std::string::npos && !recursive) name = name.substr(0, name.find("/")) + "/";
-        // push back the name, if it is not already in the vector
-        bool found = false;
-        for (const std::string& file : files) {
-            if (file == name) {
-                found = true;
-                break;
+void sleepMillis(unsigned long time) {
+#ifdef VexV5
+    vex::this_thread::sleep_for(time);
+#else
+    std::this_thread::sleep_for(std::chrono::milliseconds(time));
+#endif
+}
+
+/**
+ * @brief A mutex that can be locked again by the task that holds it
+ *
+ */
+class lemlibMutex {
+    public:
+        lemlibMutex()
+            : owner(-1),
+              depth(0),
+              acquisitions(0) {}
+
+        void lock() {
+#ifdef VexV5
+            long self = vex::this_thread::get_id();
+#else
+            long self = (long)std::hash<std::thread::id>()(std::this_thread::get_id());
+#endif
+            if (owner.load() == self) {
+                depth++;
+                return;
             }
+            mutex.lock();
+            owner.store(self);
+            depth = 1;
+            acquisitions++;
+        }
+
+        void unlock() {
+            if (--depth > 0) return;
+            owner.store(-1);
+            mutex.unlock();
+        }
+
+        /**
+         * @brief Get how many times the mutex was locked by a task that did not already hold it,
+         * which changes once per top-level call into the file system
+         *
+         * @return unsigned long the number of times
+         */
+        unsigned long getAcquisitions() { return acquisitions; }
+    private:
+#ifdef VexV5
+        vex::mutex mutex;
+#else
+        std::mutex mutex;
+#endif
+        std::atomic<long> owner;
+        int depth;
+        unsigned long acquisitions;
+};
+
+/**
+ * @brief Lock that protects the index and sectors from concurrent access by tasks
+ *
+ */
+lemlibMutex vfsMutex;
+
+/**
+ * @brief Holds the file system lock until it goes out of scope
+ *
+ */
+class lemlibLock {
+    public:
+        lemlibLock() { vfsMutex.lock(); }
+
+        ~lemlibLock() { vfsMutex.unlock(); }
+};
+
+/**
+ * @brief A task that runs a function in the background
+ *
+ */
+class lemlibTask {
+    public:
+        /**
+         * @brief Start a task
+         *
+         * @param function the function to run
+         * @param arg the argument passed to the function
+         */
+        lemlibTask(void (*function)(void*), void* arg)
+            : function(function),
+              arg(arg),
+#ifdef VexV5
+              thread(run, this) {}
+#else
+              thread(function, arg) {}
+#endif
+
+        /**
+         * @brief Wait for the function to return
+         *
+         */
+        void join() { thread.join(); }
+    private:
+        void (*function)(void*);
+        void* arg;
+#ifdef VexV5
+        vex::thread thread;
+
+        static int run(void* self) {
+            lemlibTask* task = (lemlibTask*)self;
+            task->function(task->arg);
+            return 0;
+        }
+#else
+        std::thread thread;
+#endif
+};
+
+/**
+ * @brief Get the number of tasks that can run at the same time
+ *
+ * @return unsigned int the number of cores, which is 1 on the V5
+ */
+unsigned int getCoreCount() {
+#ifdef VexV5
+    return 1;
+#else
+    unsigned int cores = std::thread::hardware_concurrency();
+    return cores == 0 ? 1 : cores;
+#endif
+}
+
+/**
+ * @brief Number of uncompressed bytes in each block of a compressed sector
+ *
+ * Blocks are compressed independently, so a part of a file can be read by
+ * decompressing only the blocks it is in.
+ */
+const unsigned long COMPRESSION_BLOCK_SIZE = 4096;
+
+/**
+ * @brief Append a variable length integer, 7 bits at a time
+ *
+ * @param out the string to append the integer to
+ * @param value the integer to append
+ */
+void putVarint(std::string& out, unsigned long long value) {
+    while (value >= 0x80) {
+        out += (char)((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    out += (char)value;
+}
+
+/**
+ * @brief Read a variable length integer
+ *
+ * @param data the data to read from
+ * @param pos the position of the integer, moved past it
+ * @param length the length of the data
+ * @return unsigned long long the integer
+ */
+unsigned long long getVarint(const char* data, size_t& pos, size_t length) {
+    unsigned long long value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (pos >= length) throw corruptFile;
+        unsigned char byte = (unsigned char)data[pos++];
+        value |= (unsigned long long)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return value;
+    }
+    throw corruptFile;
+}
+
+/**
+ * @brief Store a 32 bit value in little endian byte order
+ *
+ * @param out the string to append the value to
+ * @param value the value to store
+ */
+void putUint32(std::string& out, unsigned long value) {
+    for (int i = 0; i < 4; i++) out += (char)((value >> (8 * i)) & 0xff);
+}
+
+/**
+ * @brief Load a 32 bit value stored in little endian byte order
+ *
+ * @param data the bytes to load the value from
+ * @return unsigned long the value
+ */
+unsigned long getUint32(const char* data) {
+    unsigned long value = 0;
+    for (int i = 3; i >= 0; i--) value = (value << 8) | (unsigned char)data[i];
+    return value;
+}
+
+/**
+ * @brief Append a length that does not fit in a token nibble
+ *
+ * @param out the string to append the length to
+ * @param length the length minus 15
+ */
+void putExtendedLength(std::string& out, size_t length) {
+    for (; length >= 255; length -= 255) out += (char)255;
+    out += (char)length;
+}
+
+/**
+ * @brief Compress a block with a byte oriented LZ77 codec
+ *
+ * The block is stored as sequences of a token, literals, and a match. The high nibble
+ * of the token is the number of literals and the low nibble is the match length minus 4,
+ * where 15 means more length bytes follow. The match is a 2 byte offset back into the
+ * output. The last sequence only has literals.
+ *
+ * @param src the data to compress
+ * @param length the length of the data, at most 65536 bytes
+ * @param table scratch space of 4096 entries for the match finder
+ * @return std::string the compressed block
+ */
+std::string compressBlock(const char* src, size_t length, unsigned short* table) {
+    std::string out;
+    out.reserve(length + length / 255 + 16);
+    memset(table, 0, 4096 * sizeof(unsigned short));
+    size_t anchor = 0;
+    size_t i = 0;
+    while (i + 4 <= length) {
+        unsigned long sequence = getUint32(src + i);
+        unsigned long hash = ((sequence * 2654435761UL) & 0xffffffffUL) >> 20;
+        // positions are stored plus one, so 0 means empty
+        size_t candidate = table[hash];
+        table[hash] = (unsigned short)(i + 1);
+        if (candidate == 0 || getUint32(src + candidate - 1) != sequence) {
+            i++;
+            continue;
         }
-        if (!found) files.push_back(name);
+        size_t match = candidate - 1;
+        size_t matchLength = 4;
+        while (i + matchLength < length && src[match + matchLength] == src[i + matchLength]) matchLength++;
+        // emit the literals before the match, then the match itself
+        size_t literals = i - anchor;
+        out += (char)(((literals < 15 ? literals : 15) << 4) | (matchLength - 4 < 15 ? matchLength - 4 : 15));
+        if (literals >= 15) putExtendedLength(out, literals - 15);
+        out.append(src + anchor, literals);
+        out += (char)((i - match) & 0xff);
+        out += (char)((i - match) >> 8);
+        if (matchLength - 4 >= 15) putExtendedLength(out, matchLength - 4 - 15);
+        i += matchLength;
+        anchor = i;
+    }
+    // emit the remaining literals
+    size_t literals = length - anchor;
+    out += (char)((literals < 15 ? literals : 15) << 4);
+    if (literals >= 15) putExtendedLength(out, literals - 15);
+    out.append(src + anchor, literals);
+    return out;
+}
+
+/**
+ * @brief Read a length that does not fit in a token nibble
+ *
+ * @param src the compressed data
+ * @param pos the position of the length, moved past it
+ * @param length the length of the compressed data
+ * @return size_t the extended length
+ */
+size_t getExtendedLength(const char* src, size_t& pos, size_t length) {
+    size_t result = 0;
+    unsigned char byte;
+    do {
+        if (pos >= length) throw corruptFile;
+        byte = (unsigned char)src[pos++];
+        result += byte;
+    } while (byte == 255);
+    return result;
+}
+
+/**
+ * @brief Decompress a block compressed with compressBlock
+ *
+ * @param src the compressed block
+ * @param length the length of the compressed block
+ * @param out the string to append the decompressed data to
+ * @param size the size of the decompressed block
+ */
+void decompressBlock(const char* src, size_t length, std::string& out, size_t size) {
+    size_t start = out.length();
+    size_t pos = 0;
+    while (pos < length) {
+        unsigned char token = (unsigned char)src[pos++];
+        // copy the literals
+        size_t literals = token >> 4;
+        if (literals == 15) literals += getExtendedLength(src, pos, length);
+        if (literals > length - pos || out.length() - start + literals > size) throw corruptFile;
+        out.append(src + pos, literals);
+        pos += literals;
+        // the last sequence has no match
+        if (pos == length) break;
+        if (length - pos < 2) throw corruptFile;
+        size_t offset = (unsigned char)src[pos] | ((unsigned char)src[pos + 1] << 8);
+        pos += 2;
+        size_t matchLength = (token & 0xf) + 4;
+        if ((token & 0xf) == 15) matchLength += getExtendedLength(src, pos, length);
+        if (offset == 0 || offset > out.length() - start || out.length() - start + matchLength > size) {
+            throw corruptFile;
+        }
+        // the match can overlap the bytes it produces, so copy it byte by byte
+        size_t match = out.length() - offset;
+        for (size_t i = 0; i < matchLength; i++) out += out[match + i];
+    }
+    if (out.length() - start != size) throw corruptFile;
+}
+
+/**
+ * @brief Compress the contents of a sector
+ *
+ * The sector starts with the header "LZB1", the uncompressed size, the block size and
+ * the number of blocks, followed by the compressed size of every block. The highest bit
+ * of a block size is set if the block is stored without compression.
+ *
+ * @param data the data to compress
+ * @return std::string the compressed sector
+ */
+std::string compressData(const std::string& data) {
+    std::vector<unsigned short> table(4096);
+    unsigned long blocks = (data.length() + COMPRESSION_BLOCK_SIZE - 1) / COMPRESSION_BLOCK_SIZE;
+    std::string header = "LZB1";
+    putUint32(header, data.length());
+    putUint32(header, COMPRESSION_BLOCK_SIZE);
+    putUint32(header, blocks);
+    std::string body;
+    for (unsigned long i = 0; i < blocks; i++) {
+        size_t offset = i * COMPRESSION_BLOCK_SIZE;
+        size_t length = std::min((size_t)COMPRESSION_BLOCK_SIZE, data.length() - offset);
+        std::string block = compressBlock(data.c_str() + offset, length, &table[0]);
+        // store the block as is if it does not compress
+        if (block.length() >= length) {
+            putUint32(header, length | 0x80000000UL);
+            body.append(data, offset, length);
+        } else {
+            putUint32(header, block.length());
+            body += block;
+        }
+    }
+    return header + body;
+}
+
+/**
+ * @brief Parsed header of a compressed sector
+ *
+ * @param size the uncompressed size
+ * @param blockSize the uncompressed size of each block
+ * @param offsets the offset of each block in the sector, and the end of the last block
+ * @param stored whether each block is stored without compression
+ */
+typedef struct lemlibCompressedHeader {
+        unsigned long size;
+        unsigned long blockSize;
+        std::vector<unsigned long> offsets;
+        std::vector<bool> stored;
+} lemlibCompressedHeader;
+
+/**
+ * @brief Parse the header of a compressed sector
+ *
+ * @param data the start of the sector, which must contain the whole header
+ * @param length the number of bytes available
+ * @return lemlibCompressedHeader the parsed header
+ */
+lemlibCompressedHeader parseCompressedHeader(const char* data, size_t length) {
+    if (length < 16 || memcmp(data, "LZB1", 4) != 0) throw corruptFile;
+    lemlibCompressedHeader header;
+    header.size = getUint32(data + 4);
+    header.blockSize = getUint32(data + 8);
+    unsigned long blocks = getUint32(data + 12);
+    // unsigned long is 32 bits on the V5, so the size of the table is checked without multiplying
+    if (header.blockSize == 0 || blocks > (length - 16) / 4) throw corruptFile;
+    unsigned long offset = 16 + 4 * blocks;
+    for (unsigned long i = 0; i < blocks; i++) {
+        unsigned long blockLength = getUint32(data + 16 + 4 * i);
+        header.offsets.push_back(offset);
+        header.stored.push_back((blockLength & 0x80000000UL) != 0);
+        if (offset + (blockLength & 0x7fffffffUL) < offset) throw corruptFile;
+        offset += blockLength & 0x7fffffffUL;
+    }
+    header.offsets.push_back(offset);
+    return header;
+}
+
+/**
+ * @brief Decompress the contents of a sector compressed with compressData
+ *
+ * @param data the compressed sector
+ * @return std::string the decompressed data
+ */
+std::string decompressData(const std::string& data) {
+    // an empty sector has not been written to yet
+    if (data.length() == 0) return "";
+    lemlibCompressedHeader header = parseCompressedHeader(data.c_str(), data.length());
+    if (header.offsets.back() > data.length()) throw corruptFile;
+    std::string out;
+    out.reserve(header.size);
+    for (size_t i = 0; i + 1 < header.offsets.size(); i++) {
+        size_t length = header.offsets[i + 1] - header.offsets[i];
+        size_t size = std::min((unsigned long)header.blockSize, header.size - out.length());
+        if (header.stored[i]) {
+            if (length != size) throw corruptFile;
+            out.append(data, header.offsets[i], length);
+        } else decompressBlock(data.c_str() + header.offsets[i], length, out, size);
+    }
+    if (out.length() != header.size) throw corruptFile;
+    return out;
+}
+
+/**
+ * @brief Get the current time
+ *
+ * @return unsigned long the current time, in seconds since the epoch
+ */
+unsigned long currentTime() { return (unsigned long)time(NULL); }
+
+/**
+ * @brief Whether sector files are spread over the directories in sectors/, instead of all being
+ * in the current directory
+ *
+ */
+bool sectorDirectories = false;
+
+/**
+ * @brief Get the file a sector is stored in, in the hashed directories
+ *
+ * The last two digits of the hash of the sector pick one of 256 directories, so each directory
+ * stays small however many files there are, and opening a sector does not search a long directory.
+ * The last digits are used since the first ones barely change between short sector names.
+ *
+ * @param sector the sector
+ * @return std::string the path of the sector file, such as sectors/3/a/17
+ */
+std::string getHashedSectorFile(const std::string& sector) {
+    std::string hash = hashToString(hashData(sector.c_str(), sector.length()));
+    return "sectors/" + hash.substr(15, 1) + "/" + hash.substr(14, 1) + "/" + sector;
+}
+
+/**
+ * @brief Get the file a sector is stored in
+ *
+ * @param sector the sector
+ * @return std::string the path of the sector file
+ */
+std::string getSectorFile(const std::string& sector) {
+    return sectorDirectories ? getHashedSectorFile(sector) : sector;
+}
+
+/**
+ * @brief Get the size of a sector file
+ *
+ * @param sector the sector to measure
+ * @return unsigned long the size of the sector in bytes, or 0 if it could not be opened
+ */
+unsigned long getSectorSize(const std::string& sector) {
+    std::ifstream sectorFile;
+    sectorFile.open(getSectorFile(sector).c_str(), std::ios_base::binary | std::ios_base::ate);
+    if (!sectorFile.is_open()) return 0;
+    return (unsigned long)sectorFile.tellg();
+}
+
+/**
+ * @brief Format an entry of the index file
+ *
+ * The entry is stored as the name, followed by a slash and the sector. The metadata
+ * is appended to the sector, separated by colons. A file stored in the index has no sector,
+ * and its contents follow the metadata in hexadecimal, so they can not contain a slash or newline.
+ *
+ * @param file the entry to format
+ * @return std::string the line to store in the index file
+ */
+std::string formatIndexEntry(const lemlibFile& file) {
+    std::string line = file.name + "/" + file.sector + ":" + to_string(file.size) + ":" + to_string(file.created) +
+                       ":" + to_string(file.modified) + ":" + to_string(file.flags) + ":" + hashToString(file.hash);
+    if (!(file.flags & FILE_FLAG_INLINE)) return line;
+    const char* digits = "0123456789abcdef";
+    line += ":";
+    for (unsigned char c : file.data) {
+        line += digits[c >> 4];
+        line += digits[c & 0xf];
+    }
+    return line;
+}
+
+/**
+ * @brief Read the decimal digits of an unsigned number
+ *
+ * @param str the digits
+ * @param end set to the character after the digits
+ * @return unsigned long the number
+ */
+unsigned long parseDigits(const char* str, const char** end) {
+    unsigned long value = 0;
+    while ((unsigned char)(*str - '0') < 10) value = value * 10 + (*str++ - '0');
+    *end = str;
+    return value;
+}
+
+/**
+ * @brief Parse an entry of the index file
+ *
+ * Entries written before metadata was stored only contain the name and the sector.
+ * The size of these is read from the sector file.
+ *
+ * @param line the start of the line in the index file
+ * @param length the length of the line, without the newline
+ * @param slash the position of the last slash in the line, or std::string::npos if there is none
+ * @return lemlibFile the parsed entry
+ */
+lemlibFile parseIndexEntry(const char* line, size_t length, size_t slash) {
+    lemlibFile file = {};
+    // split the line into the name and the sector
+    // the number after the last slash is the sector
+    file.name.assign(line, slash == std::string::npos ? length : slash);
+    const char* sector = slash == std::string::npos ? line : line + slash + 1;
+    const char* end = line + length;
+    // the metadata follows the sector, separated by colons
+    const char* colon = (const char*)memchr(sector, ':', end - sector);
+    file.sector.assign(sector, colon == NULL ? end : colon);
+    if (colon == NULL) {
+        file.size = getSectorSize(file.sector);
+        return file;
+    }
+    const char* pos;
+    file.size = parseDigits(colon + 1, &pos);
+    if (*pos == ':') file.created = parseDigits(pos + 1, &pos);
+    if (*pos == ':') file.modified = parseDigits(pos + 1, &pos);
+    if (*pos == ':') file.flags = parseDigits(pos + 1, &pos);
+    if (*pos == ':') file.hash = parseHash(pos + 1, &pos);
+    if (*pos == ':' && (file.flags & FILE_FLAG_INLINE)) {
+        // every byte of the contents is two hexadecimal digits
+        pos++;
+        size_t digits = std::min((size_t)(end - pos) / 2, (size_t)file.size);
+        file.data.resize(digits);
+        for (size_t i = 0; i < digits; i++, pos += 2) {
+            const char* next;
+            char pair[3] = {pos[0], pos[1], '\0'};
+            file.data[i] = (char)parseHash(pair, &next);
+        }
+    }
+    return file;
+}
+
+/**
+ * @brief Parse an entry of the index file
+ *
+ * @param line the line in the index file
+ * @return lemlibFile the parsed entry
+ */
+lemlibFile parseIndexEntry(const std::string& line) {
+    return parseIndexEntry(line.c_str(), line.length(), line.find_last_of("/"));
+}
+
+/**
+ * @brief Find the newlines and slashes in 64 bytes of the index file
+ *
+ * Uses AVX2 or SSE2 on x86 and NEON on ARM, if the compiler targets them.
+ *
+ * @param data the bytes to search
+ * @return unsigned long long a mask with bit i set if byte i is a newline or a slash
+ */
+unsigned long long getDelimiterMask(const char* data) {
+    unsigned long long mask = 0;
+#if defined(__AVX2__)
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i slash = _mm256_set1_epi8('/');
+    for (int i = 0; i < 64; i += 32) {
+        __m256i bytes = _mm256_loadu_si256((const __m256i*)(data + i));
+        __m256i found = _mm256_or_si256(_mm256_cmpeq_epi8(bytes, newline), _mm256_cmpeq_epi8(bytes, slash));
+        mask |= (unsigned long long)(unsigned int)_mm256_movemask_epi8(found) << i;
+    }
+#elif defined(__SSE2__)
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i slash = _mm_set1_epi8('/');
+    for (int i = 0; i < 64; i += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i*)(data + i));
+        __m128i found = _mm_or_si128(_mm_cmpeq_epi8(bytes, newline), _mm_cmpeq_epi8(bytes, slash));
+        mask |= (unsigned long long)(unsigned int)_mm_movemask_epi8(found) << i;
+    }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    static const unsigned char BIT_VALUES[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    const uint8x16_t newline = vdupq_n_u8('\n');
+    const uint8x16_t slash = vdupq_n_u8('/');
+    const uint8x16_t bits = vld1q_u8(BIT_VALUES);
+    for (int i = 0; i < 64; i += 16) {
+        uint8x16_t bytes = vld1q_u8((const unsigned char*)data + i);
+        uint8x16_t found = vandq_u8(vorrq_u8(vceqq_u8(bytes, newline), vceqq_u8(bytes, slash)), bits);
+        // there is no movemask on NEON, so add up the bits of each half of the comparison
+        uint8x8_t sum = vpadd_u8(vget_low_u8(found), vget_high_u8(found));
+        sum = vpadd_u8(sum, sum);
+        sum = vpadd_u8(sum, sum);
+        mask |= (unsigned long long)vget_lane_u16(vreinterpret_u16_u8(sum), 0) << i;
+    }
+#else
+    for (int i = 0; i < 64; i++) {
+        if (data[i] == '\n' || data[i] == '/') mask |= 1ULL << i;
+    }
+#endif
+    return mask;
+}
+
+/**
+ * @brief Parse a part of an index file in one pass
+ *
+ * The newlines and slashes are found 64 bytes at a time, so each line is only searched once.
+ * Empty lines and header lines are skipped.
+ *
+ * @param text the start of the lines to parse
+ * @param length the length of the lines
+ * @param index the vector to add the entries to
+ */
+void parseFileIndex(const char* text, size_t length, std::vector<lemlibFile>& index) {
+    size_t lineStart = 0;
+    size_t slash = std::string::npos;
+    char tail[64];
+    for (size_t block = 0; block < length; block += 64) {
+        const char* bytes = text + block;
+        // the last block is copied, so the search does not read past the end of the data
+        if (length - block < 64) {
+            memset(tail, 0, sizeof(tail));
+            memcpy(tail, bytes, length - block);
+            bytes = tail;
+        }
+        for (unsigned long long mask = getDelimiterMask(bytes); mask != 0; mask &= mask - 1) {
+            size_t pos = block + __builtin_ctzll(mask);
+            if (text[pos] == '/') {
+                slash = pos;
+                continue;
+            }
+            bool hasSlash = slash != std::string::npos && slash >= lineStart;
+            // lines starting with # are the header of the index file
+            if (pos > lineStart && text[lineStart] != '#')
+                index.push_back(parseIndexEntry(text + lineStart, pos - lineStart,
+                                                hasSlash ? slash - lineStart : std::string::npos));
+            lineStart = pos + 1;
+        }
+    }
+    // the last line may not end with a newline
+    if (lineStart < length && text[lineStart] != '#') {
+        bool hasSlash = slash != std::string::npos && slash >= lineStart;
+        index.push_back(parseIndexEntry(text + lineStart, length - lineStart,
+                                        hasSlash ? slash - lineStart : std::string::npos));
+    }
+}
+
+/**
+ * @brief Index files smaller than this are parsed by a single task
+ *
+ */
+const size_t PARALLEL_PARSE_SIZE = 256 * 1024;
+
+/**
+ * @brief A part of an index file that is parsed by its own task
+ *
+ * @param text the start of the lines to parse
+ * @param length the length of the lines
+ * @param entries the parsed entries
+ */
+typedef struct lemlibParseChunk {
+        const char* text;
+        size_t length;
+        std::vector<lemlibFile> entries;
+} lemlibParseChunk;
+
+/**
+ * @brief Parse a part of an index file, run by a task
+ *
+ * @param chunk the lemlibParseChunk to parse
+ */
+void parseFileIndexChunk(void* chunk) {
+    lemlibParseChunk* part = (lemlibParseChunk*)chunk;
+    parseFileIndex(part->text, part->length, part->entries);
+}
+
+/**
+ * @brief Parse the contents of an index file
+ *
+ * Large index files are split at line boundaries into one part per core. The parts are parsed
+ * at the same time and their entries are joined in order.
+ *
+ * @param data the contents of the index file
+ * @param index the vector to add the entries to
+ */
+void parseFileIndex(const std::string& data, std::vector<lemlibFile>& index) {
+    size_t length = data.length();
+    size_t tasks = std::min((size_t)getCoreCount(), length / PARALLEL_PARSE_SIZE);
+    if (tasks < 2) {
+        parseFileIndex(data.c_str(), length, index);
+        return;
+    }
+    std::vector<lemlibParseChunk> chunks(tasks);
+    size_t start = 0;
+    for (size_t i = 0; i < tasks; i++) {
+        // end every part after a newline
+        size_t end = data.find('\n', std::max(start, length * (i + 1) / tasks));
+        end = i == tasks - 1 || end == std::string::npos ? length : end + 1;
+        chunks[i].text = data.c_str() + start;
+        chunks[i].length = end - start;
+        start = end;
+    }
+    std::vector<lemlibTask*> running;
+    for (size_t i = 1; i < tasks; i++) running.push_back(new lemlibTask(parseFileIndexChunk, &chunks[i]));
+    // this task parses the first part while the others run
+    parseFileIndexChunk(&chunks[0]);
+    for (lemlibTask* task : running) {
+        task->join();
+        delete task;
+    }
+    size_t count = index.size();
+    for (const lemlibParseChunk& chunk : chunks) count += chunk.entries.size();
+    index.reserve(count);
+    for (lemlibParseChunk& chunk : chunks) {
+        for (lemlibFile& file : chunk.entries) index.push_back(std::move(file));
+    }
+}
+
+/**
+ * @brief A Bloom filter over the paths in the index
+ *
+ * fileExists and stat check the filter before reading the index, so looking up a path that
+ * does not exist usually does not read the index at all. Every path sets a few bits. Paths are
+ * not removed, since the filter is rebuilt with the index whenever files are deleted or renamed.
+ */
+class lemlibPathFilter {
+    public:
+        lemlibPathFilter()
+            : loaded(false),
+              paths(0) {}
+
+        /**
+         * @brief Fill the filter with the paths in an index
+         *
+         * The filter is sized for the number of paths, so it is rebuilt when it gets too full.
+         *
+         * @param index the index to take the paths from
+         */
+        void rebuild(const std::vector<lemlibFile>& index) {
+            // at least 16 bits per path keeps false positives below 0.5%
+            size_t size = 1024;
+            while (size < index.size() * 16) size *= 2;
+            bits.assign(size / 8, 0);
+            paths = 0;
+            loaded = true;
+            for (const lemlibFile& file : index) add(file.name);
+        }
+
+        /**
+         * @brief Add a path to the filter
+         *
+         * @param path the normalized path
+         */
+        void add(const std::string& path) {
+            if (!loaded) return;
+            unsigned long long hash = hashData(path.c_str(), path.length());
+            for (int i = 0; i < PATH_FILTER_HASHES; i++) {
+                size_t bit = getBit(hash, i);
+                bits[bit / 8] |= (unsigned char)(1 << (bit % 8));
+            }
+            // a filter that is too full has to be resized on the next lookup
+            if (++paths * 16 > bits.size() * 8) loaded = false;
+        }
+
+        /**
+         * @brief Check if a path might be in the index
+         *
+         * @param path the normalized path
+         * @return true the path might be in the index, or the filter is not loaded
+         * @return false the path is definitely not in the index
+         */
+        bool mightContain(const std::string& path) {
+            if (!loaded) return true;
+            unsigned long long hash = hashData(path.c_str(), path.length());
+            for (int i = 0; i < PATH_FILTER_HASHES; i++) {
+                size_t bit = getBit(hash, i);
+                if (!(bits[bit / 8] & (1 << (bit % 8)))) return false;
+            }
+            return true;
+        }
+
+        /**
+         * @brief Stop using the filter until it is rebuilt
+         *
+         */
+        void invalidate() { loaded = false; }
+
+        /**
+         * @brief Check if the filter is in use
+         *
+         * @return true the filter has been built and is up to date
+         */
+        bool isLoaded() { return loaded; }
+    private:
+        static const int PATH_FILTER_HASHES = 4;
+
+        // derive every hash from the two halves of the path hash
+        size_t getBit(unsigned long long hash, int i) {
+            unsigned long low = (unsigned long)(hash & 0xffffffffULL);
+            unsigned long high = (unsigned long)(hash >> 32) | 1;
+            return (size_t)((low + (unsigned long)i * high) & 0xffffffffUL) & (bits.size() * 8 - 1);
+        }
+
+        std::vector<unsigned char> bits;
+        bool loaded;
+        size_t paths;
+};
+
+/**
+ * @brief Order index entries by path
+ *
+ * @param a the first entry
+ * @param b the second entry
+ * @return true the path of the first entry comes first
+ */
+bool compareFileNames(const lemlibFile& a, const lemlibFile& b) { return a.name < b.name; }
+
+/**
+ * @brief An index kept in memory, sorted by path
+ *
+ * The fields of the entries are kept in separate arrays, so a lookup compares the hashes of
+ * the paths in a single pass over one array, and only reads a path when its hash matches.
+ * Paths are front coded in one pool: each path only stores the bytes that differ from the path
+ * before it, and every RESTART_INTERVAL entries the full path is stored. Files in the same
+ * directory are next to each other, so a directory is listed by scanning a single range.
+ */
+class lemlibSortedIndex {
+    public:
+        lemlibSortedIndex()
+            : loaded(false) {}
+
+        /**
+         * @brief Replace the contents with the entries of an index
+         *
+         * @param index the entries, in any order
+         */
+        void build(std::vector<lemlibFile> index) {
+            // index files are written in order, so they usually do not have to be sorted again
+            if (!std::is_sorted(index.begin(), index.end(), compareFileNames))
+                std::sort(index.begin(), index.end(), compareFileNames);
+            std::string names;
+            std::vector<unsigned int> pathHashes, offsets;
+            std::vector<unsigned long> sectorIds, sizes, created, modified, flags;
+            std::vector<unsigned long long> hashes;
+            std::string inlineData;
+            pathHashes.reserve(index.size());
+            offsets.reserve(index.size());
+            sectorIds.reserve(index.size());
+            sizes.reserve(index.size());
+            created.reserve(index.size());
+            modified.reserve(index.size());
+            flags.reserve(index.size());
+            hashes.reserve(index.size());
+            for (size_t i = 0; i < index.size(); i++) {
+                const lemlibFile& file = index[i];
+                size_t shared = 0;
+                if (i % RESTART_INTERVAL != 0) {
+                    const std::string& previous = index[i - 1].name;
+                    while (shared < previous.length() && shared < file.name.length() &&
+                           previous[shared] == file.name[shared])
+                        shared++;
+                }
+                pathHashes.push_back(hashPath(file.name));
+                offsets.push_back(names.length());
+                putVarint(names, shared);
+                putVarint(names, file.name.length() - shared);
+                names.append(file.name, shared, std::string::npos);
+                // a file stored in the index has no sector, so its slot holds where its contents start
+                if (file.flags & FILE_FLAG_INLINE) {
+                    sectorIds.push_back(inlineData.length());
+                    inlineData += file.data;
+                } else {
+                    sectorIds.push_back(strtoul(file.sector.c_str(), NULL, 10));
+                }
+                sizes.push_back(file.size);
+                created.push_back(file.created);
+                modified.push_back(file.modified);
+                flags.push_back(file.flags);
+                hashes.push_back(file.hash);
+            }
+            // swapping releases the memory left over from previous builds
+            pool.swap(names);
+            this->inlineData.swap(inlineData);
+            this->pathHashes.swap(pathHashes);
+            this->offsets.swap(offsets);
+            this->sectorIds.swap(sectorIds);
+            this->sizes.swap(sizes);
+            this->created.swap(created);
+            this->modified.swap(modified);
+            this->flags.swap(flags);
+            this->hashes.swap(hashes);
+            loaded = true;
+        }
+
+        /**
+         * @brief Find the entry of a path
+         *
+         * @param path the normalized path
+         * @param file set to the entry, if it is found
+         * @return true the path is in the index
+         */
+        bool find(const std::string& path, lemlibFile& file) {
+            unsigned int hash = hashPath(path);
+            const unsigned int* pathHash = pathHashes.data();
+            size_t count = pathHashes.size();
+            for (size_t i = 0; i < count; i++) {
+                if (pathHash[i] != hash || getName(i) != path) continue;
+                file.name = path;
+                getEntry(i, file);
+                return true;
+            }
+            return false;
+        }
+
+        /**
+         * @brief Get every entry whose path starts with a prefix, in order
+         *
+         * @param prefix the start of the paths
+         * @return std::vector<lemlibFile> the entries
+         */
+        std::vector<lemlibFile> scan(const std::string& prefix) {
+            std::vector<lemlibFile> files;
+            // find the last restart point whose path is not after the prefix
+            size_t low = 0;
+            size_t high = (size() + RESTART_INTERVAL - 1) / RESTART_INTERVAL;
+            while (high - low > 1) {
+                size_t middle = (low + high) / 2;
+                if (prefix < getName(middle * RESTART_INTERVAL)) high = middle;
+                else low = middle;
+            }
+            std::string name;
+            for (size_t i = low * RESTART_INTERVAL; i < size(); i++) {
+                decodeName(i, name);
+                if (name.compare(0, prefix.length(), prefix) == 0) {
+                    files.push_back(lemlibFile());
+                    getEntry(i, files.back());
+                    files.back().name = name;
+                } else if (name > prefix) break;
+            }
+            return files;
+        }
+
+        /**
+         * @brief Get every entry whose contents have a hash
+         *
+         * @param hash the hash of the contents
+         * @return std::vector<lemlibFile> the entries
+         */
+        std::vector<lemlibFile> findHash(unsigned long long hash) {
+            std::vector<lemlibFile> files;
+            for (size_t i = 0; i < hashes.size(); i++) {
+                if (hashes[i] != hash) continue;
+                files.push_back(lemlibFile());
+                getEntry(i, files.back());
+                files.back().name = getName(i);
+            }
+            return files;
+        }
+
+        /**
+         * @brief Count the entries that use a sector
+         *
+         * @param sector the sector
+         * @param shared set to true if one of the entries has FILE_FLAG_SHARED
+         * @return int the number of entries that use the sector
+         */
+        int countSector(unsigned long sector, bool& shared) {
+            int count = 0;
+            for (size_t i = 0; i < sectorIds.size(); i++) {
+                if (sectorIds[i] != sector || (flags[i] & FILE_FLAG_INLINE)) continue;
+                count++;
+                if (flags[i] & FILE_FLAG_SHARED) shared = true;
+            }
+            return count;
+        }
+
+        /**
+         * @brief Count the references to each sector by the entries
+         *
+         * @param references the counts to add to
+         */
+        void countReferences(std::map<std::string, int>& references) {
+            for (size_t i = 0; i < sectorIds.size(); i++) {
+                if (!(flags[i] & FILE_FLAG_INLINE)) references[to_string(sectorIds[i])]++;
+            }
+        }
+
+        /**
+         * @brief Stop using the index until it is rebuilt
+         *
+         */
+        void invalidate() { loaded = false; }
+
+        /**
+         * @brief Check if the index is up to date
+         *
+         * @return true the index has been built and is up to date
+         */
+        bool isLoaded() { return loaded; }
+
+        /**
+         * @brief Get the number of entries
+         *
+         * @return size_t the number of entries
+         */
+        size_t size() { return pathHashes.size(); }
+
+        /**
+         * @brief Get the memory used by the entries
+         *
+         * @return size_t the memory used, in bytes
+         */
+        size_t memoryUsage() {
+            return pool.capacity() + inlineData.capacity() + (pathHashes.capacity() + offsets.capacity()) * sizeof(unsigned int) +
+                   (sectorIds.capacity() + sizes.capacity() + created.capacity() + modified.capacity() +
+                    flags.capacity()) *
+                       sizeof(unsigned long) +
+                   hashes.capacity() * sizeof(unsigned long long);
+        }
+    private:
+        static const size_t RESTART_INTERVAL = 16;
+
+        // hash a path to 32 bits, which is enough to rule out nearly every other path
+        static unsigned int hashPath(const std::string& path) {
+            unsigned long long hash = hashData(path.c_str(), path.length());
+            return (unsigned int)(hash ^ (hash >> 32));
+        }
+
+        // decode the path of an entry, given the path of the entry before it
+        void decodeName(size_t entry, std::string& name) {
+            size_t pos = offsets[entry];
+            size_t shared = (size_t)getVarint(pool.c_str(), pos, pool.length());
+            size_t suffix = (size_t)getVarint(pool.c_str(), pos, pool.length());
+            name.resize(shared);
+            name.append(pool, pos, suffix);
+        }
+
+        // decode the path of an entry, starting from the restart point before it
+        std::string getName(size_t entry) {
+            std::string name;
+            for (size_t i = entry - entry % RESTART_INTERVAL; i <= entry; i++) decodeName(i, name);
+            return name;
+        }
+
+        // fill in everything but the path of an entry
+        void getEntry(size_t entry, lemlibFile& file) {
+            file.size = sizes[entry];
+            file.created = created[entry];
+            file.modified = modified[entry];
+            file.flags = flags[entry];
+            file.hash = hashes[entry];
+            if (file.flags & FILE_FLAG_INLINE) {
+                file.sector = "";
+                file.data.assign(inlineData, sectorIds[entry], file.size);
+            } else {
+                file.sector = to_string(sectorIds[entry]);
+                file.data = "";
+            }
+        }
+
+        bool loaded;
+        std::string pool;
+        std::string inlineData;
+        std::vector<unsigned int> pathHashes;
+        std::vector<unsigned int> offsets;
+        std::vector<unsigned long> sectorIds;
+        std::vector<unsigned long> sizes;
+        std::vector<unsigned long> created;
+        std::vector<unsigned long> modified;
+        std::vector<unsigned long> flags;
+        std::vector<unsigned long long> hashes;
+};
+
+/**
+ * @brief What an index file looked like when it was read, to notice when another program changes it
+ *
+ * @param size the size of the file in bytes
+ * @param modified the modification time of the file, which is always 0 on the V5
+ * @param generation the number in the header of the file, which is incremented every time it is written
+ * @param checkpoint the size of the checkpoint at the start of the file, without the lines appended
+ * after it
+ */
+typedef struct lemlibIndexState {
+        unsigned long size;
+        unsigned long modified;
+        unsigned long generation;
+        unsigned long checkpoint;
+} lemlibIndexState;
+
+/**
+ * @brief Get the size, modification time and generation of an index file
+ *
+ * Only the header line of the file is read.
+ *
+ * @param fileName the index file
+ * @return lemlibIndexState the state of the file, which is all 0 if it does not exist
+ */
+lemlibIndexState getIndexState(const std::string& fileName) {
+    lemlibIndexState state = {};
+    std::ifstream indexFile;
+    indexFile.open(fileName.c_str(), std::ios_base::binary);
+    if (!indexFile.is_open()) return state;
+    std::string header;
+    std::getline(indexFile, header);
+    indexFile.clear();
+    indexFile.seekg(0, std::ios_base::end);
+    state.size = (unsigned long)indexFile.tellg();
+    // a header without a length covers the whole file
+    state.checkpoint = state.size;
+    if (header.length() > 0 && header[0] == '#') {
+        char* end;
+        state.generation = strtoul(header.c_str() + 1, &end, 10);
+        unsigned long length = *end == ':' ? strtoul(end + 1, NULL, 10) : state.size;
+        state.checkpoint = std::min(state.size, (unsigned long)header.length() + 1 + length);
+    }
+#ifndef VexV5
+    struct stat info;
+    if (::stat(fileName.c_str(), &info) == 0) state.modified = (unsigned long)info.st_mtime;
+#endif
+    return state;
+}
+
+/**
+ * @brief Check if two states of an index file are the same
+ *
+ * @param a the first state
+ * @param b the second state
+ * @return true the file has not changed
+ */
+bool isSameIndexState(const lemlibIndexState& a, const lemlibIndexState& b) {
+    return a.size == b.size && a.modified == b.modified && a.generation == b.generation;
+}
+
+/**
+ * @brief Format the header line of a file whose contents are checked when it is read
+ *
+ * The header is #generation:length:checksum, where the checksum covers the length bytes after
+ * the header. Lines appended to the file later are not covered, and carry their own checksum.
+ *
+ * @param generation the generation of the file
+ * @param body the contents of the file after the header
+ * @return std::string the header line
+ */
+std::string formatChecksumHeader(unsigned long generation, const std::string& body) {
+    return "#" + to_string(generation) + ":" + to_string((unsigned long)body.length()) + ":" +
+           hashToString(hashData(body.c_str(), body.length())) + "\n";
+}
+
+/**
+ * @brief Check the header line of a file written with formatChecksumHeader
+ *
+ * A file without a checksum in its header, such as one written by an older version or by hand,
+ * is accepted as it is.
+ *
+ * @param contents the contents of the file
+ * @param body set to the position after the header line
+ * @param length set to the number of bytes covered by the checksum, which is 0 without a checksum
+ * @return true the checksum matches, or there is none
+ */
+bool checkChecksumHeader(const std::string& contents, size_t& body, size_t& length) {
+    body = 0;
+    length = 0;
+    if (contents.length() == 0 || contents[0] != '#') return true;
+    size_t end = contents.find('\n');
+    body = end == std::string::npos ? contents.length() : end + 1;
+    char* pos;
+    strtoul(contents.c_str() + 1, &pos, 10);
+    if (*pos != ':') return true;
+    unsigned long covered = strtoul(pos + 1, &pos, 10);
+    if (*pos != ':' || covered > contents.length() - body) return false;
+    const char* hashEnd;
+    unsigned long long checksum = parseHash(pos + 1, &hashEnd);
+    if (hashEnd != pos + 17) return false;
+    length = covered;
+    return hashData(contents.c_str() + body, length) == checksum;
+}
+
+/**
+ * @brief Format a line that is appended to an index file after its checkpoint
+ *
+ * @param line the entry
+ * @return std::string the entry, prefixed with + and its checksum
+ */
+std::string formatJournalLine(const std::string& line) {
+    return "+" + hashToString(hashData(line.c_str(), line.length())) + line;
+}
+
+/**
+ * @brief Remove the checksums from the lines appended to an index file after its checkpoint
+ *
+ * A line with a wrong checksum was cut short by a power loss while it was appended, so it and
+ * everything after it is dropped.
+ *
+ * @param contents the contents of the index file, which are changed in place
+ * @param start the position where the checkpoint ends
+ */
+void stripJournal(std::string& contents, size_t start) {
+    size_t journal = start;
+    if (journal < contents.length() && contents[journal] != '+') {
+        journal = contents.find("\n+", journal);
+        if (journal == std::string::npos) return;
+        journal++;
+    }
+    std::string lines;
+    for (size_t pos = journal; pos < contents.length();) {
+        size_t end = contents.find('\n', pos);
+        if (end == std::string::npos) end = contents.length();
+        if (contents[pos] == '+') {
+            const char* hashEnd;
+            if (end - pos < 17) break;
+            unsigned long long checksum = parseHash(contents.c_str() + pos + 1, &hashEnd);
+            if (hashEnd != contents.c_str() + pos + 17 ||
+                hashData(contents.c_str() + pos + 17, end - pos - 17) != checksum)
+                break;
+            lines.append(contents, pos + 17, end - pos - 17);
+        } else {
+            lines.append(contents, pos, end - pos);
+        }
+        lines += "\n";
+        pos = end + 1;
+    }
+    contents.erase(journal);
+    contents += lines;
+}
+
+/**
+ * @brief Get the top-level directory of a path, which decides the part of the index it is stored in
+ *
+ * @param path the normalized path
+ * @return std::string the top-level directory, or an empty string for files in the root directory
+ */
+std::string getShardName(const std::string& path) {
+    size_t slash = path.find("/", 1);
+    return slash == std::string::npos ? "" : path.substr(1, slash - 1);
+}
+
+/**
+ * @brief Get one of the two index files a part of the index alternates between
+ *
+ * @param shard the top-level directory of the part
+ * @param slot which of the two files, 0 or 1
+ * @return std::string index.txt or index.1.txt for the root directory, or an index file named after
+ * the hash of the directory
+ */
+std::string getShardFile(const std::string& shard, int slot) {
+    std::string name = shard == "" ? "index" : "index." + hashToString(hashData(shard.c_str(), shard.length()));
+    return name + (slot == 0 ? ".txt" : ".1.txt");
+}
+
+/**
+ * @brief The checkpoint of a part of the index that the superblock points to
+ *
+ * @param generation the generation of the checkpoint, which is in the header of its index file
+ * @param slot which of the two index files of the part holds the checkpoint
+ */
+typedef struct lemlibCheckpoint {
+        unsigned long generation;
+        int slot;
+} lemlibCheckpoint;
+
+/**
+ * @brief The superblock, which points to the latest checkpoint of every part of the index
+ *
+ * A checkpoint is written to the index file of its part that is not in use, and only takes
+ * effect when the superblock is written after it, so a power loss in between leaves the last
+ * checkpoint in place. The superblock itself alternates between two files, so one of them is
+ * always whole.
+ *
+ * @param sequence incremented every time the superblock is written, to find the newest copy
+ * @param parts the checkpoints of the root directory and every top-level directory with files
+ * @param sectors every sector that may be in use is numbered below this, so new sectors are numbered
+ * from it. It is 0 when it is not known, such as on an SD card from an older version
+ */
+typedef struct lemlibSuperblock {
+        unsigned long sequence;
+        std::map<std::string, lemlibCheckpoint> parts;
+        unsigned long sectors;
+} lemlibSuperblock;
+
+/**
+ * @brief The newest copy of the superblock
+ *
+ */
+lemlibSuperblock superblock;
+
+/**
+ * @brief The number of the next new sector, which is below the sectors reserved in the superblock
+ *
+ */
+unsigned long nextSector = 0;
+
+/**
+ * @brief Sectors below nextSector that are not used, which are handed out before new sectors
+ *
+ */
+std::vector<std::string> unusedSectors;
+
+/**
+ * @brief Whether the superblock has been read
+ *
+ */
+bool superblockLoaded = false;
+
+/**
+ * @brief The states of the two copies of the superblock when they were last read or written
+ *
+ */
+lemlibIndexState superblockStates[2];
+
+/**
+ * @brief The lock acquisition in which the superblock was last checked for changes
+ *
+ */
+unsigned long superblockChecked = 0;
+
+/**
+ * @brief Top-level directories that were taken out of the superblock, whose index files are
+ * removed once it is written
+ *
+ */
+std::vector<std::string> removedShards;
+
+/**
+ * @brief Get one of the two files the superblock alternates between
+ *
+ * @param copy which of the two files, 0 or 1
+ * @return std::string superblock.a.txt or superblock.b.txt
+ */
+std::string getSuperblockFile(int copy) {
+    return copy == 0 ? "superblock.a.txt" : "superblock.b.txt";
+}
+
+/**
+ * @brief Read one copy of the superblock
+ *
+ * @param fileName the file of the copy
+ * @param result set to the superblock
+ * @return true the copy exists and its checksum matches
+ */
+bool readSuperblockFile(const std::string& fileName, lemlibSuperblock& result) {
+    std::ifstream file;
+    file.open(fileName.c_str(), std::ios_base::binary);
+    if (!file.is_open()) return false;
+    std::ostringstream stream;
+    stream << file.rdbuf();
+    std::string contents = stream.str();
+    size_t body, length;
+    // the root directory is always listed, so a copy without a checksum was cut short
+    if (!checkChecksumHeader(contents, body, length) || length == 0 || body + length != contents.length())
+        return false;
+    result.sequence = strtoul(contents.c_str() + 1, NULL, 10);
+    result.parts.clear();
+    result.sectors = 0;
+    std::istringstream lines(contents.substr(body));
+    for (std::string line; std::getline(lines, line);) {
+        if (line.compare(0, 8, "sectors:") == 0) {
+            result.sectors = strtoul(line.c_str() + 8, NULL, 10);
+            continue;
+        }
+        // each line is /directory:generation:slot, and the root directory is /
+        size_t slot = line.rfind(':');
+        size_t generation = slot == std::string::npos || slot == 0 ? std::string::npos : line.rfind(':', slot - 1);
+        if (generation == std::string::npos || line[0] != '/') return false;
+        lemlibCheckpoint checkpoint = {strtoul(line.c_str() + generation + 1, NULL, 10), line[slot + 1] == '1' ? 1 : 0};
+        result.parts[line.substr(1, generation - 1)] = checkpoint;
+    }
+    return true;
+}
+
+/**
+ * @brief Write the superblock over the older of its two copies
+ *
+ * The index files of top-level directories that were taken out of the superblock are removed
+ * afterwards, since the previous superblock points to them until this one is written.
+ */
+void writeSuperblock() {
+    lemlibLock lock;
+    superblock.sequence++;
+    std::string body;
+    for (const std::pair<const std::string, lemlibCheckpoint>& part : superblock.parts) {
+        // a new top-level directory is only listed once its first checkpoint is written
+        if (part.second.generation == 0 && part.second.slot == 1) continue;
+        body += "/" + part.first + ":" + to_string(part.second.generation) + ":" + to_string(part.second.slot) + "\n";
+    }
+    body += "sectors:" + to_string(superblock.sectors) + "\n";
+    int copy = superblock.sequence % 2;
+    std::ofstream file;
+    file.open(getSuperblockFile(copy).c_str(), std::ios_base::binary);
+    if (!file.is_open()) throw cannotOpenFile;
+    file << formatChecksumHeader(superblock.sequence, body) << body;
+    file.close();
+    superblockStates[copy] = getIndexState(getSuperblockFile(copy));
+    for (const std::string& shard : removedShards) {
+        std::remove(getShardFile(shard, 0).c_str());
+        std::remove(getShardFile(shard, 1).c_str());
+    }
+    removedShards.clear();
+}
+
+/**
+ * @brief Get the superblock, reading the newest whole copy if it is not in memory
+ *
+ * Only the two small copies of the superblock are read, so mounting takes the same time however
+ * many files there are, and a copy that was cut short by a power loss is skipped. They are read
+ * again if another program changes them, which is checked once per call into the file system.
+ * Another program writes over the older copy first, so only that copy is checked. Without a
+ * superblock, such as on an SD card from an older version, one is made from index.txt and the
+ * list of top-level directories in shards.txt.
+ *
+ * @return lemlibSuperblock& the superblock
+ */
+lemlibSuperblock& readSuperblock() {
+    lemlibLock lock;
+    if (superblockLoaded && superblockChecked == vfsMutex.getAcquisitions()) return superblock;
+    superblockChecked = vfsMutex.getAcquisitions();
+    int older = (superblock.sequence + 1) % 2;
+    if (superblockLoaded && isSameIndexState(getIndexState(getSuperblockFile(older)), superblockStates[older]))
+        return superblock;
+    lemlibIndexState states[2] = {getIndexState(getSuperblockFile(0)), getIndexState(getSuperblockFile(1))};
+    lemlibSuperblock copies[2];
+    bool valid[2] = {readSuperblockFile(getSuperblockFile(0), copies[0]),
+                     readSuperblockFile(getSuperblockFile(1), copies[1])};
+    superblockStates[0] = states[0];
+    superblockStates[1] = states[1];
+    superblockLoaded = true;
+    // sectors another program took may have been free here, so only new sectors are handed out
+    unusedSectors.clear();
+    if (valid[0] || valid[1]) {
+        superblock = valid[0] && (!valid[1] || copies[0].sequence > copies[1].sequence) ? copies[0] : copies[1];
+        nextSector = superblock.sectors;
+        return superblock;
+    }
+    superblock.sequence = 0;
+    superblock.parts.clear();
+    superblock.sectors = 0;
+    nextSector = 0;
+    std::vector<std::string> list(1, "");
+    std::ifstream listFile;
+    listFile.open("shards.txt");
+    if (listFile.is_open()) {
+        for (std::string line; std::getline(listFile, line);) {
+            if (line != "") list.push_back(line);
+        }
+    }
+    listFile.close();
+    for (const std::string& shard : list) {
+        // use whichever of the two index files of the part was written last
+        lemlibCheckpoint checkpoint = {getIndexState(getShardFile(shard, 0)).generation, 0};
+        unsigned long other = getIndexState(getShardFile(shard, 1)).generation;
+        if (other > checkpoint.generation) {
+            checkpoint.generation = other;
+            checkpoint.slot = 1;
+        }
+        superblock.parts[shard] = checkpoint;
+    }
+    writeSuperblock();
+    std::remove("shards.txt");
+    return superblock;
+}
+
+/**
+ * @brief Read the top-level directories that have their own index file
+ *
+ * @return std::vector<std::string> the top-level directories, as listed in the superblock
+ */
+std::vector<std::string> readShardList() {
+    lemlibLock lock;
+    std::vector<std::string> list;
+    for (const std::pair<const std::string, lemlibCheckpoint>& part : readSuperblock().parts) {
+        if (part.first != "") list.push_back(part.first);
+    }
+    return list;
+}
+
+/**
+ * @brief Get the index file that holds the latest checkpoint of a part of the index
+ *
+ * @param shard the top-level directory of the part
+ * @return std::string the index file
+ */
+std::string getShardFile(const std::string& shard) {
+    lemlibSuperblock& current = readSuperblock();
+    std::map<std::string, lemlibCheckpoint>::iterator found = current.parts.find(shard);
+    return getShardFile(shard, found == current.parts.end() ? 0 : found->second.slot);
+}
+
+/**
+ * @brief The part of the index for one top-level directory, kept in memory
+ *
+ * @param index the sorted entries of the part
+ * @param filter the filter over the paths of the part
+ * @param state the state of the index file of the part when it was last read or written
+ * @param dirty whether the part was changed in memory and needs a new checkpoint
+ * @param journal entries added in memory that still have to be appended to the index file
+ * @param checked the lock acquisition in which the index file was last checked for changes
+ */
+typedef struct lemlibShard {
+        lemlibSortedIndex index;
+        lemlibPathFilter filter;
+        lemlibIndexState state;
+        bool dirty;
+        std::string journal;
+        unsigned long checked;
+} lemlibShard;
+
+/**
+ * @brief The parts of the index that have been loaded, by top-level directory
+ *
+ */
+std::map<std::string, lemlibShard> shards;
+
+/**
+ * @brief Every change to the index is written before the function that made it returns
+ *
+ */
+const int DURABILITY_IMMEDIATE = 0;
+
+/**
+ * @brief Changes to the index are written together once enough of them were made, or the oldest
+ * of them is old enough
+ *
+ */
+const int DURABILITY_GROUP = 1;
+
+/**
+ * @brief Changes to the index are only written when syncIndex is called
+ *
+ */
+const int DURABILITY_SYNC = 2;
+
+/**
+ * @brief When changes to the index are written, set with setDurability
+ *
+ */
+int durability = DURABILITY_IMMEDIATE;
+
+/**
+ * @brief The longest time in milliseconds a change to the index waits with DURABILITY_GROUP
+ *
+ */
+unsigned long groupCommitInterval = 100;
+
+/**
+ * @brief The number of changes to the index that are written together with DURABILITY_GROUP
+ *
+ */
+unsigned long groupCommitChanges = 16;
+
+/**
+ * @brief The number of changes to the index that have not been written yet
+ *
+ */
+unsigned long pendingChanges = 0;
+
+/**
+ * @brief When the oldest change that has not been written yet was made, in microseconds
+ *
+ */
+unsigned long long firstPendingChange = 0;
+
+/**
+ * @brief Write entries to an index file, after a header with the generation and checksum of the file
+ *
+ * The entries are written sorted by path, so loading the index does not have to sort them.
+ *
+ * @param entries the entries to write
+ * @param fileName the index file
+ * @param generation the generation to put in the header
+ */
+void writeIndexFile(const std::vector<lemlibFile>& entries, const std::string& fileName, unsigned long generation) {
+    std::vector<lemlibFile> index = entries;
+    std::sort(index.begin(), index.end(), compareFileNames);
+    std::string body;
+    for (const lemlibFile& line : index) {
+        body += formatIndexEntry(line);
+        body += "\n";
+    }
+    std::ofstream indexFile;
+    indexFile.open(fileName.c_str(), std::ios_base::binary);
+    if (!indexFile.is_open()) throw cannotOpenFile;
+    indexFile << formatChecksumHeader(generation, body) << body;
+    indexFile.close();
+}
+
+/**
+ * @brief Write a checkpoint of a part of the index
+ *
+ * The checkpoint is written to the index file of the part that is not in use, and only takes
+ * effect when writeSuperblock is called.
+ *
+ * @param shard the top-level directory of the part
+ * @param entries the entries of the part
+ */
+void writeCheckpoint(const std::string& shard, const std::vector<lemlibFile>& entries) {
+    lemlibLock lock;
+    lemlibSuperblock& current = readSuperblock();
+    std::map<std::string, lemlibCheckpoint>::iterator found = current.parts.find(shard);
+    lemlibShard& part = shards[shard];
+    // the index files of a directory without files are not needed
+    if (shard != "" && entries.size() == 0) {
+        if (found != current.parts.end()) {
+            current.parts.erase(found);
+            removedShards.push_back(shard);
+        }
+        part.state = lemlibIndexState();
+        return;
+    }
+    lemlibCheckpoint checkpoint = {0, 1};
+    if (found != current.parts.end()) checkpoint = found->second;
+    checkpoint.generation++;
+    checkpoint.slot = 1 - checkpoint.slot;
+    std::string fileName = getShardFile(shard, checkpoint.slot);
+    writeIndexFile(entries, fileName, checkpoint.generation);
+    current.parts[shard] = checkpoint;
+    removedShards.erase(std::remove(removedShards.begin(), removedShards.end(), shard), removedShards.end());
+    part.state = getIndexState(fileName);
+}
+
+/**
+ * @brief Empty sectors that were created ahead of time, so a file can take one without creating a file
+ *
+ */
+std::vector<std::string> sectorPool;
+
+/**
+ * @brief The number of sectors to keep in the pool, set with setSectorPool
+ *
+ */
+size_t sectorPoolSize = 0;
+
+/**
+ * @brief Sectors that are no longer used by the index in memory, but may still be used by the index
+ * on the SD card, so they are not emptied or reused until the index is written
+ *
+ */
+std::vector<std::string> freedSectors;
+
+/**
+ * @brief Sectors that were allocated since the index was last written, so the index on the SD card
+ * does not use them yet
+ *
+ */
+std::vector<std::string> allocatedSectors;
+
+/**
+ * @brief The number of times each sector is held open by a ring file, which keeps it from being
+ * emptied or reused until it is closed
+ *
+ */
+std::map<std::string, int> openSectors;
+
+/**
+ * @brief Keep a sector from being emptied or reused while it is open
+ *
+ * @param sector the sector that was opened
+ */
+void pinSector(const std::string& sector) {
+    lemlibLock lock;
+    openSectors[sector]++;
+}
+
+/**
+ * @brief Let a sector be emptied and reused again once it is closed
+ *
+ * @param sector the sector that was closed
+ */
+void unpinSector(const std::string& sector) {
+    lemlibLock lock;
+    if (--openSectors[sector] <= 0) openSectors.erase(sector);
+}
+
+/**
+ * @brief Empty the sectors that were freed, once the index that no longer uses them is written
+ *
+ * The emptied sectors go back to the pool if the pool is not full, and are reused before new
+ * sectors otherwise. Sectors that are still open
+ * are kept until a later call, since writes that are still buffered would land in them.
+ */
+void releaseFreedSectors() {
+    lemlibLock lock;
+    std::vector<std::string> open;
+    for (const std::string& sector : freedSectors) {
+        if (openSectors.count(sector)) {
+            open.push_back(sector);
+            continue;
+        }
+        std::ofstream sectorFile;
+        sectorFile.open(getSectorFile(sector).c_str());
+        sectorFile << "";
+        sectorFile.close();
+        if (sectorPool.size() < sectorPoolSize && std::find(sectorPool.begin(), sectorPool.end(), sector) == sectorPool.end())
+            sectorPool.push_back(sector);
+        else unusedSectors.push_back(sector);
+    }
+    freedSectors.swap(open);
+}
+
+/**
+ * @brief Write the changes to the index that have not been written yet
+ *
+ * Entries that were only added are appended to the index file of their part in one write. A part
+ * with other changes gets a new checkpoint, and the superblock is written once after all of them.
+ * Sectors that were freed are emptied afterwards.
+ */
+void syncIndex() {
+    lemlibLock lock;
+    if (pendingChanges == 0) {
+        allocatedSectors.clear();
+        releaseFreedSectors();
+        return;
+    }
+    bool checkpointed = false;
+    for (std::pair<const std::string, lemlibShard>& shard : shards) {
+        lemlibShard& part = shard.second;
+        if (part.dirty) {
+            writeCheckpoint(shard.first, part.index.scan(""));
+            checkpointed = true;
+        } else if (part.journal != "") {
+            std::string fileName = getShardFile(shard.first);
+            std::ofstream indexFile;
+            indexFile.open(fileName.c_str(), std::ios_base::app | std::ios_base::binary);
+            if (!indexFile.is_open()) throw cannotOpenFile;
+            indexFile << part.journal;
+            indexFile.close();
+            part.state = getIndexState(fileName);
+        }
+        part.dirty = false;
+        part.journal.clear();
+    }
+    if (checkpointed) writeSuperblock();
+    pendingChanges = 0;
+    allocatedSectors.clear();
+    releaseFreedSectors();
+}
+
+/**
+ * @brief Count a change to the index in memory, and write the changes if the durability level asks for it
+ *
+ */
+void indexChanged() {
+    lemlibLock lock;
+    if (pendingChanges++ == 0) firstPendingChange = microseconds();
+    if (durability == DURABILITY_IMMEDIATE) syncIndex();
+    else if (durability == DURABILITY_GROUP &&
+             (pendingChanges >= groupCommitChanges ||
+              microseconds() - firstPendingChange >= (unsigned long long)groupCommitInterval * 1000))
+        syncIndex();
+}
+
+/**
+ * @brief Replace the entries of a part of the index in memory, which is written by syncIndex
+ *
+ * @param shard the top-level directory of the part
+ * @param entries the entries of the part
+ */
+void setShardEntries(const std::string& shard, const std::vector<lemlibFile>& entries) {
+    lemlibLock lock;
+    lemlibSuperblock& current = readSuperblock();
+    lemlibShard& part = shards[shard];
+    part.index.build(entries);
+    part.filter.rebuild(entries);
+    part.dirty = true;
+    part.journal.clear();
+    // list a new top-level directory right away, so it is found before its checkpoint is written
+    if (entries.size() > 0 && current.parts.find(shard) == current.parts.end()) {
+        lemlibCheckpoint checkpoint = {0, 1};
+        current.parts[shard] = checkpoint;
+    }
+}
+
+/**
+ * @brief Read the index file
+ *
+ * The checksum in the header of the file has to match. Lines appended after the checkpoint are
+ * checked one by one, and the last ones are dropped if a power loss cut them short.
+ *
+ * @param fileName the index file to read, which can also be a snapshot of the index. By default,
+ * the latest checkpoints of the root and every top-level directory are read, and parts with
+ * changes that have not been written yet are taken from memory
+ * @return std::vector<lemlibFile> contents of the index file
+ */
+std::vector<lemlibFile> readFileIndex(const char* fileName = NULL) {
+    lemlibLock lock;
+    // Initialize the vector
+    std::vector<lemlibFile> index;
+    if (fileName == NULL) {
+        std::vector<std::string> list = readShardList();
+        list.insert(list.begin(), "");
+        for (const std::string& shard : list) {
+            std::map<std::string, lemlibShard>::iterator found = shards.find(shard);
+            std::vector<lemlibFile> entries =
+                found != shards.end() && (found->second.dirty || found->second.journal != "")
+                    ? found->second.index.scan("")
+                    : readFileIndex(getShardFile(shard).c_str());
+            index.insert(index.end(), entries.begin(), entries.end());
+        }
+        return index;
+    }
+    // Open the index file
+    std::ifstream indexFile;
+    indexFile.open(fileName, std::ios_base::binary);
+    // throw an exception if the index file could not be opened
+    if (!indexFile.is_open()) throw cannotOpenFile;
+    // read the whole index file, so it can be parsed in one pass
+    std::ostringstream stream;
+    stream << indexFile.rdbuf();
+    std::string contents = stream.str();
+    size_t body, length;
+    if (!checkChecksumHeader(contents, body, length)) throw corruptFile;
+    bool journaled = contents.length() > body + length;
+    stripJournal(contents, body + length);
+    parseFileIndex(contents, index);
+    // a file that was written after the checkpoint has a later line, which replaces the earlier one
+    if (journaled) {
+        std::stable_sort(index.begin(), index.end(), compareFileNames);
+        std::vector<lemlibFile> latest;
+        latest.reserve(index.size());
+        for (const lemlibFile& file : index) {
+            if (latest.size() > 0 && latest.back().name == file.name) latest.back() = file;
+            else latest.push_back(file);
+        }
+        index.swap(latest);
+    }
+    return index;
+}
+
+/**
+ * @brief Overwrite the index file
+ *
+ * @param entries the entries to write to the index file
+ * @param fileName the index file to write, which can also be a snapshot of the index. By default,
+ * every part of the index is replaced in memory, and written as one group of checkpoints that all
+ * take effect at once when the superblock is written
+ */
+void writeFileIndex(const std::vector<lemlibFile>& entries, const char* fileName = NULL) {
+    lemlibLock lock;
+    if (fileName == NULL) {
+        // files may have moved between directories, so find the sectors that are used in more than one
+        std::map<std::string, std::set<std::string> > users;
+        for (const lemlibFile& file : entries) {
+            if (!(file.flags & FILE_FLAG_INLINE)) users[file.sector].insert(getShardName(file.name));
+        }
+        std::map<std::string, std::vector<lemlibFile> > parts;
+        // directories that no longer have files are written empty, which removes them
+        parts[""];
+        for (const std::string& shard : readShardList()) parts[shard];
+        for (lemlibFile file : entries) {
+            if (!(file.flags & FILE_FLAG_INLINE) && users[file.sector].size() > 1) file.flags |= FILE_FLAG_SHARED;
+            else file.flags &= ~FILE_FLAG_SHARED;
+            parts[getShardName(file.name)].push_back(file);
+        }
+        for (const std::pair<const std::string, std::vector<lemlibFile> >& part : parts)
+            setShardEntries(part.first, part.second);
+        indexChanged();
+        return;
+    }
+    // the generation in the header changes on every write, even if the size and time do not
+    writeIndexFile(entries, fileName, getIndexState(fileName).generation + 1);
+}
+
+/**
+ * @brief Get a part of the index, reading its index file if it is not in memory
+ *
+ * The part is read again if its index file was changed by another program, such as the host
+ * tool or a computer the SD card was put in. This is checked once per call into the file system
+ * with the size, modification time and generation of the file, so the file is not parsed when it
+ * has not changed.
+ *
+ * @param shard the top-level directory of the part
+ * @return lemlibShard& the part of the index
+ */
+lemlibShard& loadShard(const std::string& shard) {
+    lemlibLock lock;
+    lemlibSuperblock& current = readSuperblock();
+    std::map<std::string, lemlibCheckpoint>::iterator found = current.parts.find(shard);
+    bool listed = found != current.parts.end();
+    lemlibShard& part = shards[shard];
+    if (part.index.isLoaded() && part.checked == vfsMutex.getAcquisitions()) return part;
+    part.checked = vfsMutex.getAcquisitions();
+    std::string fileName = getShardFile(shard, listed ? found->second.slot : 0);
+    lemlibIndexState state = getIndexState(fileName);
+    // changes that have not been written yet are kept, even if the index file was changed
+    bool pending = part.dirty || part.journal != "";
+    if (part.index.isLoaded() && !pending && !isSameIndexState(state, part.state)) part.index.invalidate();
+    if (!part.index.isLoaded()) {
+        std::vector<lemlibFile> entries;
+        // a top-level directory without files has no index file
+        if (shard == "" || listed) entries = readFileIndex(fileName.c_str());
+        for (const lemlibFile& file : entries) {
+            // index.txt used to hold every file, so move the files in directories to their own index files
+            if (getShardName(file.name) != shard) {
+                writeFileIndex(readFileIndex());
+                return part;
+            }
+        }
+        part.index.build(entries);
+        part.filter.rebuild(entries);
+        part.state = state;
+    }
+    return part;
+}
+
+/**
+ * @brief The number of bytes the lines appended to an index file can always grow to before the part
+ * gets a new checkpoint. Beyond that, they can grow as large as the checkpoint
+ *
+ */
+const unsigned long JOURNAL_SIZE = 4096;
+
+/**
+ * @brief Add an entry to the end of the index file of its top-level directory
+ *
+ * Only the new line is written, with its own checksum, and the part of the index in memory is
+ * updated, so it does not have to be read again. The line is written when the durability level
+ * asks for it, together with the lines of other new entries. An entry for a path that is already
+ * in the index replaces it, and its line replaces the earlier line when the index file is read.
+ *
+ * @param file the new entry
+ */
+void appendShardEntry(const lemlibFile& file) {
+    lemlibLock lock;
+    std::string shard = getShardName(file.name);
+    lemlibShard& part = loadShard(shard);
+    std::vector<lemlibFile> entries = part.index.scan("");
+    std::vector<lemlibFile>::iterator position =
+        std::lower_bound(entries.begin(), entries.end(), file, compareFileNames);
+    bool replaced = position != entries.end() && position->name == file.name;
+    if (replaced) *position = file;
+    else entries.insert(position, file);
+    lemlibSuperblock& current = readSuperblock();
+    // once the lines are longer than the checkpoint, reading them would take longer than writing it
+    unsigned long journal = part.state.size - part.state.checkpoint + part.journal.length();
+    // a new top-level directory starts with a checkpoint, so an old index file is never appended to
+    if (part.dirty || current.parts.find(shard) == current.parts.end() ||
+        journal > std::max(JOURNAL_SIZE, part.state.checkpoint)) {
+        setShardEntries(shard, entries);
+    } else {
+        part.index.build(entries);
+        if (!replaced) part.filter.add(file.name);
+        // the filter turns itself off when too many paths were added, so size it for the new entries
+        if (!part.filter.isLoaded()) part.filter.rebuild(entries);
+        part.journal += formatJournalLine(formatIndexEntry(file)) + "\n";
+    }
+    indexChanged();
+}
+
+/**
+ * @brief Read the part of the index a path is in
+ *
+ * Only the top-level directory of the path is read, so files in other directories are not touched.
+ *
+ * @param path the normalized path
+ * @return std::vector<lemlibFile> the entries in the same top-level directory as the path
+ */
+std::vector<lemlibFile> readShardIndex(const std::string& path) {
+    return loadShard(getShardName(path)).index.scan("");
+}
+
+/**
+ * @brief Overwrite the part of the index a path is in
+ *
+ * @param path the normalized path
+ * @param entries the entries in the same top-level directory as the path
+ */
+void writeShardIndex(const std::string& path, const std::vector<lemlibFile>& entries) {
+    lemlibLock lock;
+    setShardEntries(getShardName(path), entries);
+    indexChanged();
+}
+
+/**
+ * @brief Whether the task that writes changes to the index with DURABILITY_GROUP should keep running
+ *
+ */
+std::atomic<bool> groupCommitRunning(false);
+
+/**
+ * @brief The task that writes changes to the index with DURABILITY_GROUP, or NULL if it is not running
+ *
+ */
+lemlibTask* groupCommitTask = NULL;
+
+/**
+ * @brief Body of the task that writes changes to the index with DURABILITY_GROUP
+ *
+ * Changes are also written when they are made, once there are enough of them or the oldest is
+ * old enough. This task writes them when no more changes are made.
+ */
+void groupCommit(void*) {
+    while (groupCommitRunning.load()) {
+        sleepMillis(groupCommitInterval);
+        lemlibLock lock;
+        if (pendingChanges == 0 ||
+            microseconds() - firstPendingChange < (unsigned long long)groupCommitInterval * 1000)
+            continue;
+        // the changes are kept in memory and written again next time if the SD card fails
+        try {
+            syncIndex();
+        } catch (...) {}
+    }
+}
+
+/**
+ * @brief Set when changes to the index are written to the SD card
+ *
+ * Changes that have not been written yet are written first. With DURABILITY_GROUP, a burst of
+ * new files only takes a few writes, but the last interval of changes can be lost in a power
+ * loss. With DURABILITY_SYNC, nothing is written until syncIndex is called. Either way, files
+ * that are rewritten or appended to get a new sector the first time, and the old sector, like the
+ * sectors of deleted files, keeps its contents until the changes are written, so a power loss
+ * brings back the files as they were.
+ *
+ * @param level DURABILITY_IMMEDIATE, DURABILITY_GROUP or DURABILITY_SYNC
+ * @param interval with DURABILITY_GROUP, the longest time in milliseconds a change waits
+ * @param changes with DURABILITY_GROUP, the number of changes that are written together
+ */
+void setDurability(int level, unsigned long interval = 100, unsigned long changes = 16) {
+    // the task is stopped without the lock, since it may be waiting for it
+    if (groupCommitTask != NULL) {
+        groupCommitRunning.store(false);
+        groupCommitTask->join();
+        delete groupCommitTask;
+        groupCommitTask = NULL;
+    }
+    lemlibLock lock;
+    syncIndex();
+    durability = level;
+    groupCommitInterval = interval == 0 ? 1 : interval;
+    groupCommitChanges = changes == 0 ? 1 : changes;
+    if (level == DURABILITY_GROUP) {
+        groupCommitRunning.store(true);
+        groupCommitTask = new lemlibTask(groupCommit, NULL);
+    }
+}
+
+/**
+ * @brief Read the names of the snapshots of the index
+ *
+ * @return std::vector<std::string> the names of the snapshots
+ */
+std::vector<std::string> readSnapshotList() {
+    lemlibLock lock;
+    std::vector<std::string> snapshots;
+    std::ifstream listFile;
+    listFile.open("snapshots.txt");
+    // there are no snapshots if the list does not exist
+    if (!listFile.is_open()) return snapshots;
+    for (std::string line; std::getline(listFile, line);) {
+        if (line != "") snapshots.push_back(line);
+    }
+    return snapshots;
+}
+
+/**
+ * @brief Get the name of the index file a snapshot is stored in
+ *
+ * @param name the name of the snapshot
+ * @return std::string the name of the snapshot index file
+ */
+std::string getSnapshotFile(const std::string& name) { return "snapshot." + name + ".txt"; }
+
+/**
+ * @brief The number of references to each sector by the snapshots
+ *
+ */
+std::map<std::string, int> snapshotReferences;
+
+/**
+ * @brief Whether the snapshots have been read into snapshotReferences
+ *
+ */
+bool snapshotReferencesLoaded = false;
+
+/**
+ * @brief Add the references of the entries of a snapshot to snapshotReferences, or remove them
+ *
+ * @param snapshotIndex the entries of the snapshot
+ * @param count 1 to add the references, or -1 to remove them
+ */
+void countSnapshotReferences(const std::vector<lemlibFile>& snapshotIndex, int count) {
+    lemlibLock lock;
+    for (const lemlibFile& file : snapshotIndex) {
+        if (file.flags & FILE_FLAG_INLINE) continue;
+        if ((snapshotReferences[file.sector] += count) <= 0) snapshotReferences.erase(file.sector);
+    }
+}
+
+/**
+ * @brief Get the number of references to each sector by the snapshots
+ *
+ * The snapshots are only read the first time, and the counts are updated when a snapshot is taken
+ * or deleted.
+ *
+ * @return std::map<std::string, int>& the number of references to each sector used by a snapshot
+ */
+std::map<std::string, int>& readSnapshotReferences() {
+    lemlibLock lock;
+    if (snapshotReferencesLoaded) return snapshotReferences;
+    snapshotReferences.clear();
+    for (const std::string& snapshot : readSnapshotList())
+        countSnapshotReferences(readFileIndex(getSnapshotFile(snapshot).c_str()), 1);
+    snapshotReferencesLoaded = true;
+    return snapshotReferences;
+}
+
+/**
+ * @brief Count the references to each sector
+ *
+ * Every part of the index is read, so this is only used by operations on the whole file system.
+ * Single files use countSectorReferences.
+ *
+ * @return std::map<std::string, int> the number of references to each used sector
+ */
+std::map<std::string, int> getSectorReferences() {
+    lemlibLock lock;
+    // the parts of the index and the snapshots are counted from memory, so they are only read once
+    std::map<std::string, int> references = readSnapshotReferences();
+    loadShard("").index.countReferences(references);
+    for (const std::string& shard : readShardList()) loadShard(shard).index.countReferences(references);
+    return references;
+}
+
+/**
+ * @brief Count the references to the sector of a file
+ *
+ * Sectors are shared by copies of a file and by snapshots, so a sector can only be modified or
+ * emptied when it is referenced once. Only the part of the index the file is in and the snapshots
+ * are counted, unless the sector is also used in other top-level directories.
+ *
+ * @param path the normalized path of the file
+ * @param sector the sector of the file
+ * @return int the number of references to the sector
+ */
+int countSectorReferences(const std::string& path, const std::string& sector) {
+    lemlibLock lock;
+    // files stored in the index have no sector
+    if (sector == "") return 0;
+    std::map<std::string, int>& snapshots = readSnapshotReferences();
+    std::map<std::string, int>::iterator found = snapshots.find(sector);
+    int count = found == snapshots.end() ? 0 : found->second;
+    unsigned long id = strtoul(sector.c_str(), NULL, 10);
+    std::string shard = getShardName(path);
+    bool shared = false;
+    count += loadShard(shard).index.countSector(id, shared);
+    if (!shared) return count;
+    std::vector<std::string> list = readShardList();
+    list.insert(list.begin(), "");
+    for (const std::string& other : list) {
+        if (other != shard) count += loadShard(other).index.countSector(id, shared);
+    }
+    return count;
+}
+
+/**
+ * @brief Mark the files in a top-level directory that use a sector as sharing it with other directories
+ *
+ * The part of the index is written with the change that shared the sector.
+ *
+ * @param shard the top-level directory
+ * @param sector the sector
+ */
+void markSectorShared(const std::string& shard, const std::string& sector) {
+    lemlibLock lock;
+    std::vector<lemlibFile> entries = loadShard(shard).index.scan("");
+    bool changed = false;
+    for (lemlibFile& file : entries) {
+        if (file.sector != sector || (file.flags & FILE_FLAG_SHARED)) continue;
+        file.flags |= FILE_FLAG_SHARED;
+        changed = true;
+    }
+    if (changed) setShardEntries(shard, entries);
+}
+
+/**
+ * @brief The sector the pool task is creating, which can not be allocated until it is in the pool
+ *
+ */
+std::string reservedSector;
+
+/**
+ * @brief The number of sectors reserved in the superblock at a time
+ *
+ */
+const unsigned long SECTOR_RESERVATION = 64;
+
+/**
+ * @brief Find the sectors that are not used, by reading every part of the index
+ *
+ * The sectors below the highest one in use that are not used are handed out before new sectors.
+ * This is needed once for an SD card from an older version, and finds sectors that were freed
+ * before the last mount.
+ */
+void scanSectors() {
+    lemlibLock lock;
+    std::set<std::string> used;
+    for (const std::pair<const std::string, int>& sector : getSectorReferences()) used.insert(sector.first);
+    used.insert(sectorPool.begin(), sectorPool.end());
+    used.insert(freedSectors.begin(), freedSectors.end());
+    used.insert(unusedSectors.begin(), unusedSectors.end());
+    if (reservedSector != "") used.insert(reservedSector);
+    for (const std::pair<const std::string, int>& sector : openSectors) used.insert(sector.first);
+    unsigned long highest = 0;
+    for (const std::string& sector : used) highest = std::max(highest, strtoul(sector.c_str(), NULL, 10) + 1);
+    // sectors that were already handed out are above the ones in use or in the lists
+    nextSector = std::max(nextSector, highest);
+    for (unsigned long sector = 0; sector < highest; sector++) {
+        if (!used.count(to_string(sector))) unusedSectors.push_back(to_string(sector));
+    }
+}
+
+/**
+ * @brief Get a sector that is not used, without reading the index
+ *
+ * New sectors are reserved in the superblock in groups before they are handed out, so the index
+ * never points to a sector that could be handed out again after a power loss.
+ *
+ * @return std::string the sector
+ */
+std::string newSector() {
+    lemlibLock lock;
+    lemlibSuperblock& current = readSuperblock();
+    if (current.sectors == 0) {
+        scanSectors();
+        // the sectors found are free either way, so the count is written with the next reservation
+        current.sectors = nextSector;
+    }
+    if (unusedSectors.size() > 0) {
+        std::string sector = unusedSectors.back();
+        unusedSectors.pop_back();
+        return sector;
+    }
+    if (nextSector >= current.sectors) {
+        current.sectors = nextSector + SECTOR_RESERVATION;
+        writeSuperblock();
+    }
+    return to_string(nextSector++);
+}
+
+/**
+ * @brief Find a sector that is not used
+ *
+ * A sector from the pool is taken if there is one, since its file already exists.
+ *
+ * @return std::string the free sector
+ */
+std::string allocateSector() {
+    lemlibLock lock;
+    std::string sector;
+    if (sectorPool.size() == 0) sector = newSector();
+    else {
+        sector = sectorPool.back();
+        sectorPool.pop_back();
+    }
+    allocatedSectors.push_back(sector);
+    return sector;
+}
+
+/**
+ * @brief Whether the contents of a sector can be changed in place
+ *
+ * With DURABILITY_GROUP or DURABILITY_SYNC, the index on the SD card may still point to the sector
+ * with the old size and hash, so a power loss would bring back the old entry with the new contents.
+ * Such a sector is only changed in place if it was allocated after the index was last written.
+ *
+ * @param sector the sector
+ * @return true if the sector can be changed in place
+ */
+bool canWriteInPlace(const std::string& sector) {
+    lemlibLock lock;
+    if (durability == DURABILITY_IMMEDIATE) return true;
+    return std::find(allocatedSectors.begin(), allocatedSectors.end(), sector) != allocatedSectors.end();
+}
+
+/**
+ * @brief Empty a sector once the index that no longer uses it is written
+ *
+ * Until then, the index on the SD card may still point to the sector, so it keeps its contents
+ * and is not reused.
+ *
+ * @param sector the sector to empty
+ */
+void freeSector(const std::string& sector) {
+    lemlibLock lock;
+    // files stored in the index have no sector
+    if (sector == "") return;
+    if (std::find(freedSectors.begin(), freedSectors.end(), sector) == freedSectors.end())
+        freedSectors.push_back(sector);
+    // a ring file that still has the sector open reopens it, and finds out its file is gone
+    sharingGeneration++;
+}
+
+/**
+ * @brief The time in milliseconds the pool task waits when the pool is full
+ *
+ */
+unsigned long sectorPoolInterval = 50;
+
+/**
+ * @brief Whether the task that fills the pool of sectors should keep running
+ *
+ */
+std::atomic<bool> sectorPoolRunning(false);
+
+/**
+ * @brief The task that fills the pool of sectors, or NULL if it is not running
+ *
+ */
+lemlibTask* sectorPoolTask = NULL;
+
+/**
+ * @brief Body of the task that fills the pool of sectors
+ *
+ * The sector files are created without the lock, so creating them does not block other tasks. New
+ * sectors are handed out without reading the index, so the lock is only held briefly.
+ */
+void fillSectorPool(void*) {
+    while (sectorPoolRunning.load()) {
+        std::string sector;
+        try {
+            lemlibLock lock;
+            if (sectorPool.size() < sectorPoolSize) sector = newSector();
+            reservedSector = sector;
+        } catch (...) {}
+        if (sector == "") {
+            sleepMillis(sectorPoolInterval);
+            continue;
+        }
+        std::ofstream sectorFile;
+        sectorFile.open(getSectorFile(sector).c_str(), std::ios_base::binary);
+        bool created = sectorFile.is_open();
+        sectorFile.close();
+        {
+            lemlibLock lock;
+            reservedSector = "";
+            if (created && sectorPool.size() < sectorPoolSize) sectorPool.push_back(sector);
+            else unusedSectors.push_back(sector);
+        }
+        // try again later if the SD card is not writable
+        if (!created) sleepMillis(sectorPoolInterval);
+    }
+}
+
+/**
+ * @brief Set the number of sectors that are created ahead of time
+ *
+ * Creating a file is one of the slowest operations on the SD card, so a background task keeps
+ * this many empty sector files ready, and a file that needs a sector takes one from the pool.
+ * Sectors that are emptied also go back to the pool.
+ *
+ * @param size the number of sectors in the pool, or 0 to stop creating them
+ * @param interval the time in milliseconds the task waits when the pool is full
+ */
+void setSectorPool(size_t size, unsigned long interval = 50) {
+    // the task is stopped without the lock, since it may be waiting for it
+    if (sectorPoolTask != NULL) {
+        sectorPoolRunning.store(false);
+        sectorPoolTask->join();
+        delete sectorPoolTask;
+        sectorPoolTask = NULL;
+    }
+    lemlibLock lock;
+    sectorPoolSize = size;
+    sectorPoolInterval = interval == 0 ? 1 : interval;
+    // sectors taken out of the pool are still handed out before new ones
+    while (sectorPool.size() > size) {
+        unusedSectors.push_back(sectorPool.back());
+        sectorPool.pop_back();
+    }
+    if (size > 0) {
+        sectorPoolRunning.store(true);
+        sectorPoolTask = new lemlibTask(fillSectorPool, NULL);
+    }
+}
+
+/**
+ * @brief Marker file that shows the SD card uses the hashed sector directories
+ *
+ */
+const char* SECTOR_LAYOUT_FILE = "sectors/layout.txt";
+
+/**
+ * @brief Find out where sector files are stored, and move them to the hashed directories if they can be created
+ *
+ * The V5 can not create directories, so it keeps every sector in the current directory unless the
+ * SD card was set up on the host. On the host, the directories are created and the sectors in use
+ * are moved into them the first time a card is mounted.
+ *
+ * @return true sector files are in the hashed directories
+ */
+bool setupSectorDirectories() {
+    lemlibLock lock;
+    std::ifstream marker;
+    marker.open(SECTOR_LAYOUT_FILE);
+    if (marker.is_open()) return true;
+#ifdef VexV5
+    return false;
+#else
+    const char* digits = "0123456789abcdef";
+    ::mkdir("sectors", 0755);
+    for (int i = 0; i < 16; i++) {
+        std::string directory = std::string("sectors/") + digits[i];
+        ::mkdir(directory.c_str(), 0755);
+        for (int j = 0; j < 16; j++) ::mkdir((directory + "/" + digits[j]).c_str(), 0755);
+    }
+    // the sectors are moved before the marker is written, so an interrupted move is finished next time
+    for (const std::pair<const std::string, int>& sector : getSectorReferences())
+        std::rename(sector.first.c_str(), getHashedSectorFile(sector.first).c_str());
+    std::ofstream layout;
+    layout.open(SECTOR_LAYOUT_FILE);
+    // keep the old layout if the directories could not be created
+    if (!layout.is_open()) return false;
+    // the version of the layout, after the flat one
+    layout << "2" << std::endl;
+    layout.close();
+    return true;
+#endif
+}
+
+/**
+ * @brief Initialize the file system
+ *
+ * Only the superblock is read to mount, which points to the latest whole checkpoint of every
+ * part of the index, so recovering from a power loss does not have to scan the index files. A
+ * lazy mount reads each part of the index when it is first used, so the robot is ready sooner.
+ * Otherwise the whole index is read now, so the first operations do not have to wait for it, and
+ * sectors that were freed before the last mount are found so they can be reused. Sector files are
+ * kept in hashed directories when the SD card has them.
+ *
+ * @param lazy whether to read the index when it is first used
+ */
+void initVFS(bool lazy = false) {
+    lemlibLock lock;
+    // Check if the index file exists
+    std::ifstream indexFile;
+    indexFile.open("index.txt");
+    // If the index file does not exist, create it
+    if (!indexFile.is_open()) {
+        std::ofstream indexFile;
+        indexFile.open("index.txt");
+        // throw an exception if the index file could not be created
+        if (!indexFile.is_open()) throw vfsInitFailed;
+        indexFile.close();
+    }
+    indexFile.close();
+    // forget the index of a file system that was mounted before, after writing its changes
+    syncIndex();
+    shards.clear();
+    superblockLoaded = false;
+    snapshotReferencesLoaded = false;
+    removedShards.clear();
+    std::vector<std::string> list = readShardList();
+    // find the sector files before any of them is opened, in the current directory while they are moved
+    sectorDirectories = false;
+    sectorDirectories = setupSectorDirectories();
+    // without any top-level directories, index.txt may still hold every file, and has to be split now
+    if (lazy && list.size() == 0) loadShard("");
+    if (lazy) return;
+    loadShard("");
+    for (const std::string& shard : list) loadShard(shard);
+    scanSectors();
+}
+
+/**
+ * @brief Read the raw contents of a sector
+ *
+ * @param sector the sector to read
+ * @return std::string the contents of the sector
+ */
+std::string readSector(const std::string& sector) {
+    lemlibLock lock;
+    std::ifstream sectorFile;
+    sectorFile.open(getSectorFile(sector).c_str(), std::ios_base::binary);
+    if (!sectorFile.is_open()) throw cannotOpenFile;
+    std::ostringstream contents;
+    contents << sectorFile.rdbuf();
+    return contents.str();
+}
+
+/**
+ * @brief Read the contents of a file from its sector, or from its entry if it is stored in the index
+ *
+ * @param file the entry of the file
+ * @return std::string the contents of the file
+ */
+std::string readFileData(const lemlibFile& file) {
+    if (file.flags & FILE_FLAG_INLINE) return file.data;
+    // a sector that was reserved but not written yet only holds zeros
+    if ((file.flags & FILE_FLAG_PREALLOCATED) && file.size == 0) return "";
+    std::string data = readSector(file.sector);
+    if (file.flags & FILE_FLAG_COMPRESSED) return decompressData(data);
+    // the space reserved after the contents is not part of the file
+    if (file.flags & FILE_FLAG_PREALLOCATED) data.resize(std::min((unsigned long)data.length(), file.size));
+    return data;
+}
+
+/**
+ * @brief Write data into a sector without truncating it, so the space reserved after it is kept
+ *
+ * @param sector the sector to write
+ * @param offset the position to write the data at
+ * @param data the data to write
+ */
+void writeSectorAt(const std::string& sector, unsigned long offset, const std::string& data) {
+    std::fstream file;
+    std::string fileName = getSectorFile(sector);
+    file.open(fileName.c_str(), std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+    if (!file.is_open()) {
+        // the sector file may not exist yet, but opening an existing one for output would empty it
+        std::ifstream existing;
+        existing.open(fileName.c_str(), std::ios_base::binary);
+        if (existing.is_open()) throw cannotOpenFile;
+        file.open(fileName.c_str(), std::ios_base::out | std::ios_base::binary);
+    }
+    if (!file.is_open()) throw cannotOpenFile;
+    file.seekp(offset);
+    file.write(data.c_str(), data.length());
+    if (!file) throw cannotOpenFile;
+}
+
+/**
+ * @brief Allocate space for a sector on the SD card, so it is not extended piece by piece
+ *
+ * On Linux the space is allocated without writing it. Elsewhere, including the V5, the sector is
+ * extended with zeros.
+ *
+ * @param sector the sector to allocate space for
+ * @param bytes the size of the sector in bytes, which it is never shrunk below
+ */
+void preallocateSector(const std::string& sector, unsigned long bytes) {
+#if !defined(VexV5) && defined(__linux__)
+    int file = ::open(getSectorFile(sector).c_str(), O_WRONLY | O_CREAT, 0644);
+    if (file < 0) throw cannotOpenFile;
+    int result = posix_fallocate(file, 0, (off_t)bytes);
+    ::close(file);
+    if (result != 0) throw cannotOpenFile;
+#else
+    unsigned long size = getSectorSize(sector);
+    if (size >= bytes) return;
+    writeSectorAt(sector, size, std::string(bytes - size, '\0'));
+#endif
+}
+
+/**
+ * @brief Find a file that already stores the given contents
+ *
+ * The top-level directories that are not in the given index are searched in their parts of the
+ * index that are already in memory, so files in different directories can share a sector without
+ * reading the index of every directory.
+ *
+ * @param index the entries being changed, which are searched instead of their parts of the index
+ * @param data the contents to find
+ * @param hash the hash of the contents
+ * @param flags the flags of the file that will use the sector
+ * @param duplicate set to a file whose sector has the same contents
+ * @return true a file with the same contents was found
+ */
+bool findDuplicate(const std::vector<lemlibFile>& index, const std::string& data, unsigned long long hash,
+                   unsigned long flags, lemlibFile& duplicate) {
+    lemlibLock lock;
+    // ring files are written in place, so they can not share a sector
+    if (flags & FILE_FLAG_RING) return false;
+    std::vector<lemlibFile> candidates;
+    std::set<std::string> searched;
+    for (const lemlibFile& file : index) {
+        searched.insert(getShardName(file.name));
+        if (file.hash == hash) candidates.push_back(file);
+    }
+    for (std::pair<const std::string, lemlibShard>& shard : shards) {
+        if (searched.count(shard.first) || !shard.second.index.isLoaded()) continue;
+        std::vector<lemlibFile> found = shard.second.index.findHash(hash);
+        candidates.insert(candidates.end(), found.begin(), found.end());
+    }
+    for (const lemlibFile& file : candidates) {
+        // whether the sector is shared with other directories does not change what it stores
+        if (file.size != data.length() || ((file.flags ^ flags) & ~FILE_FLAG_SHARED) != 0) continue;
+        // make sure it is not a hash collision
+        if (readFileData(file) == data) {
+            duplicate = file;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Get the metadata of a virtual file
+ *
+ * @param path the path of the virtual file
+ * @return lemlibFile the index entry of the file
+ */
+lemlibFile stat(const char* path) {
+    lemlibLock lock;
+    std::string filePath = path;
+    // if the path does not start with a slash, add one
+    if (filePath.find("/") != 0) filePath = "/" + filePath;
+    lemlibShard& shard = loadShard(getShardName(filePath));
+    if (!shard.filter.mightContain(filePath)) throw fileNotFound;
+    lemlibFile file = {};
+    if (!shard.index.find(filePath, file)) throw fileNotFound;
+    return file;
+}
+
+/**
+ * @brief Get the metadata of a virtual file
+ *
+ * @param path the path of the virtual file
+ * @return lemlibFile the index entry of the file
+ */
+lemlibFile stat(std::string path) { return stat(path.c_str()); }
+
+/**
+ * @brief Get the Sector object
+ *
+ * @param path the path of the virtual file
+ * @return const char* the sector the file is stored in, which is empty if it is stored in the index,
+ * or null if the file is not found
+ */
+const char* getFileSector(const char* path) {
+    lemlibLock lock;
+    std::string filePath = path;
+    // if the path does not start with a slash, add one
+    if (filePath.find("/") != 0) filePath = "/" + filePath;
+    // the sector is kept alive after the function returns
+    static std::string sector;
+    lemlibFile file = {};
+    // Return null if the file is not found
+    lemlibShard& shard = loadShard(getShardName(filePath));
+    if (!shard.filter.mightContain(filePath) || !shard.index.find(filePath, file)) return NULL;
+    sector = file.sector;
+    return sector.c_str();
+}
+
+/**
+ * @brief Get the Sector object
+ *
+ * @param path the path of the virtual file
+ * @return const char* the sector the file is stored in, or null if the file is not found
+ */
+const char* getFileSector(std::string path) { return getFileSector(path.c_str()); }
+
+/**
+ * @brief List all the files and folders in a directory
+ *
+ * @param dir the directory to list
+ * @return std::vector <std::string> a vector of all the files and folders in the directory
+ */
+std::vector<std::string> listDirectory(const char* dir, bool recursive = false) {
+    lemlibLock lock;
+    std::string directory = dir;
+    // if the path does not start with a slash, add one
+    if (directory.find("/") != 0) directory = "/" + directory;
+    // a directory below the top level is in a single part of the index
+    std::vector<std::string> paths;
+    std::vector<std::string> parts(1, getShardName(directory));
+    if (directory.find("/", 1) == std::string::npos) {
+        for (const std::string& shard : readShardList()) {
+            std::string top = "/" + shard + "/";
+            if (top.compare(0, directory.length(), directory) != 0) continue;
+            // top-level directories always have files, so they are listed without reading their index
+            if (recursive) parts.push_back(shard);
+            else paths.push_back(top);
+        }
+    }
+    // the files in the directory are next to each other in the sorted index
+    for (const std::string& shard : parts) {
+        for (const lemlibFile& line : loadShard(shard).index.scan(directory)) paths.push_back(line.name);
+    }
+    std::sort(paths.begin(), paths.end());
+    // Initialize the vector
+    std::vector<std::string> files;
+    for (const std::string& path : paths) {
+        // remove the directory from the name
+        std::string name = path.substr(directory.length());
+        // if there is a remaining slash, a directory is found
+        if (name.find("/") != std::string::npos && !recursive) name = name.substr(0, name.find("/")) + "/";
+        // the files in a subdirectory are sorted together, so it only has to be compared with the last name
+        if (files.size() == 0 || files.back() != name) files.push_back(name);
+    }
+    return files;
+}
+
+/**
+ * @brief List all the files and folders in a directory
+ *
+ * @param dir the directory to list
+ * @return std::vector <std::string> a vector of all the files and folders in the directory
+ */
+std::vector<std::string> listDirectory(std::string dir, bool recursive = false) {
+    return listDirectory(dir.c_str(), recursive);
+}
+
+/**
+ * @brief Check if a file exists
+ *
+ * @param path path of the file
+ * @return true the file exists
+ * @return false the file does not exist
+ */
+bool fileExists(const char* path) {
+    lemlibLock lock;
+    std::string filePath = path;
+    // if the path does not start with a slash, add one
+    if (filePath.find("/") != 0) filePath = "/" + filePath;
+    // most paths that are not in the index are ruled out without searching it
+    lemlibShard& shard = loadShard(getShardName(filePath));
+    if (!shard.filter.mightContain(filePath)) return false;
+    lemlibFile file = {};
+    return shard.index.find(filePath, file);
+}
+
+/**
+ * @brief Check if a file exists
+ *
+ * @param path path of the file
+ * @return true the file exists
+ * @return false the file does not exist
+ */
+bool fileExists(std::string path) { return fileExists(path.c_str()); }
+
+/**
+ * @brief delete a virtual file
+ *
+ * @param path the path of the virtual file
+ */
+void deleteFile(const char* path) {
+    lemlibLock lock;
+    std::string filePath = path;
+    // if the path does not start with a slash, add one
+    if (filePath.find("/") != 0) filePath = "/" + filePath;
+    // check if the file exists
+    if (!fileExists(filePath)) throw fileNotFound;
+    // empty the sector the file is stored in, unless it is shared with a copy or a snapshot
+    std::string sector = getFileSector(filePath);
+    if (countSectorReferences(filePath, sector) <= 1) freeSector(sector);
+    // remove the file from the index file
+    std::vector<lemlibFile> index = readShardIndex(filePath);
+    std::vector<lemlibFile> remaining;
+    for (const lemlibFile& line : index) {
+        if (line.name != filePath) remaining.push_back(line);
+    }
+    writeShardIndex(filePath, remaining);
+}
+
+/**
+ * @brief delete a virtual file
+ *
+ * @param path the path of the virtual file
+ */
+void deleteFile(std::string path) { deleteFile(path.c_str()); }
+
+/**
+ * @brief Read the directories whose new files are compressed
+ *
+ * @return std::vector<std::string> the compressed directories
+ */
+std::vector<std::string> readCompressionList() {
+    lemlibLock lock;
+    std::vector<std::string> directories;
+    std::ifstream listFile;
+    listFile.open("compression.txt");
+    // no directories are compressed if the list does not exist
+    if (!listFile.is_open()) return directories;
+    for (std::string line; std::getline(listFile, line);) {
+        if (line != "") directories.push_back(line);
+    }
+    return directories;
+}
+
+/**
+ * @brief Reserve space for a virtual file, so it stays in one piece on the SD card as it grows
+ *
+ * The sector is allocated at the given size, while the size in the index stays the size of the
+ * contents. A file that is stored in the index or shares its sector is moved to its own sector first.
+ *
+ * @param path the path of the virtual file
+ * @param bytes the number of bytes to reserve for the file
+ */
+void reserve(const char* path, unsigned long bytes) {
+    lemlibLock lock;
+    std::string filePath = path;
+    // if the path does not start with a slash, add one
+    if (filePath.find("/") != 0) filePath = "/" + filePath;
+    if (!fileExists(filePath)) throw fileNotFound;
+    std::vector<lemlibFile> index = readShardIndex(filePath);
+    for (lemlibFile& entry : index) {
+        if (entry.name != filePath) continue;
+        // ring files are allocated at their full size when they are created
+        if (entry.flags & FILE_FLAG_RING) return;
+        if (entry.sector == "" || countSectorReferences(filePath, entry.sector) > 1) {
+            std::string contents = readFileData(entry);
+            entry.sector = allocateSector();
+            entry.flags &= ~FILE_FLAG_INLINE;
+            entry.data = "";
+            std::ofstream file;
+            file.open(getSectorFile(entry.sector).c_str(), std::ios_base::binary);
+            if (!file.is_open()) throw cannotOpenFile;
+            if (entry.flags & FILE_FLAG_COMPRESSED) file << compressData(contents);
+            else file << contents;
+            file.close();
+        }
+        preallocateSector(entry.sector, bytes);
+        entry.flags |= FILE_FLAG_PREALLOCATED;
+    }
+    writeShardIndex(filePath, index);
+}
+
+/**
+ * @brief Reserve space for a virtual file
+ *
+ * @param path the path of the virtual file
+ * @param bytes the number of bytes to reserve for the file
+ */
+void reserve(std::string path, unsigned long bytes) { reserve(path.c_str(), bytes); }
+
+/**
+ * @brief Create a virtual file
+ *
+ * The new file is empty, so it is only added to the index. Its sector is created when enough
+ * data is written to it, so creating a file and then writing it only writes the sector once.
+ *
+ * @param path the path of the virtual file
+ * @param overwrite whether to replace the file if it already exists
+ * @param sizeHint the number of bytes to reserve for the file, if it is known how large it will grow
+ * @return const char* the sector the file is stored in, which is empty until data is written to it
+ * unless space is reserved
+ */
+const char* createFile(const char* path, bool overwrite = true, unsigned long sizeHint = 0) {
+    lemlibLock lock;
+    std::string filePath = path;
+    // if the path does not start with a slash, add one
+    if (filePath.find("/") != 0) filePath = "/" + filePath;
+    // Check if the file already exists
+    if (fileExists(filePath)) {
+        // If the file should be overwritten, delete the file
+        if (overwrite) deleteFile(filePath);
+        // Otherwise, throw an exception
+        else throw fileAlreadyExists;
+    }
+    // Create the file, which is stored in the index until it is written to
+    lemlibFile file = {};
+    file.name = filePath;
+    file.flags = FILE_FLAG_INLINE;
+    file.hash = hashData("", 0);
+    file.created = currentTime();
+    file.modified = file.created;
+    // compress the file if its directory is compressed
+    for (const std::string& directory : readCompressionList()) {
+        if (filePath.find(directory) == 0) file.flags |= FILE_FLAG_COMPRESSED;
+    }
+    // Create the file in the index file of its top-level directory
+    appendShardEntry(file);
+    if (sizeHint > 0) reserve(filePath, sizeHint);
+    return getFileSector(filePath);
+}
+
+/**
+ * @brief Create a virtual file
+ *
+ * @param path the path of the virtual file
+ * @param overwrite whether to replace the file if it already exists
+ * @param sizeHint the number of bytes to reserve for the file, if it is known how large it will grow
+ * @return const char* the sector the file is stored in, which is empty until data is written to it
+ * unless space is reserved
+ */
+const char *createFile(std::string path, bool overwrite = true, unsigned long sizeHint = 0) {
+    return createFile(path.c_str(), overwrite, sizeHint);
+}
+
+/**
+ * @brief Store the contents of a file in its sector
+ *
+ * The sector is compressed if the file has FILE_FLAG_COMPRESSED set. Contents up to
+ * INLINE_FILE_SIZE bytes are stored in the entry instead, and the sector is released, unless
+ * space was reserved for the file. The size and hash of the entry are updated, but the index file
+ * is not written.
+ *
+ * @param index the index the entry is in
+ * @param entry the entry of the file
+ * @param contents the new contents of the file
+ */
+void storeFileData(std::vector<lemlibFile>& index, lemlibFile* entry, const std::string& contents) {
+    lemlibLock lock;
+    unsigned long long hash = hashData(contents.c_str(), contents.length());
+    int references = countSectorReferences(entry->name, entry->sector);
+    // ring files are written in place and reserved space is kept, so they always need a sector
+    if (contents.length() <= INLINE_FILE_SIZE && !(entry->flags & (FILE_FLAG_RING | FILE_FLAG_PREALLOCATED))) {
+        if (references <= 1) freeSector(entry->sector);
+        entry->sector = "";
+        entry->flags |= FILE_FLAG_INLINE;
+        entry->flags &= ~FILE_FLAG_SHARED;
+        entry->data = contents;
+        entry->size = contents.length();
+        entry->hash = hash;
+        return;
+    }
+    // a file that grew too large for its entry, or a new ring file, gets a sector of its own
+    if (entry->sector == "") {
+        entry->flags &= ~FILE_FLAG_INLINE;
+        entry->data = "";
+        entry->sector = allocateSector();
+        references = 0;
+    }
+    // if the same contents are already stored, share their sector instead of writing them again
+    lemlibFile duplicate = {};
+    bool found = deduplicate && findDuplicate(index, contents, hash, entry->flags, duplicate);
+    if (found && duplicate.sector != entry->sector) {
+        if (references <= 1) freeSector(entry->sector);
+        entry->sector = duplicate.sector;
+        sharingGeneration++;
+        std::string shard = getShardName(entry->name);
+        std::string other = getShardName(duplicate.name);
+        if (other != shard) {
+            // both directories count the references in every part of the index from now on
+            entry->flags |= FILE_FLAG_SHARED;
+            bool inIndex = false;
+            for (lemlibFile& file : index) {
+                if (file.sector != duplicate.sector || getShardName(file.name) != other) continue;
+                file.flags |= FILE_FLAG_SHARED;
+                inIndex = true;
+            }
+            if (!inIndex) markSectorShared(other, duplicate.sector);
+        }
+    } else if (!found) {
+        // if the sector is shared with a copy or a snapshot, move the file to its own sector, and
+        // if the index on the SD card still uses it, write the new contents next to the old ones
+        unsigned long reserved = 0;
+        if (references > 1 || (!(entry->flags & FILE_FLAG_RING) && !canWriteInPlace(entry->sector))) {
+            if (entry->flags & FILE_FLAG_PREALLOCATED) reserved = getSectorSize(entry->sector);
+            if (references <= 1) freeSector(entry->sector);
+            entry->sector = allocateSector();
+            entry->flags &= ~FILE_FLAG_SHARED;
+        }
+
+        std::string data = entry->flags & FILE_FLAG_COMPRESSED ? compressData(contents) : contents;
+        if (entry->flags & FILE_FLAG_PREALLOCATED) {
+            // the new sector keeps the space that was reserved for the old one
+            if (reserved > 0) preallocateSector(entry->sector, reserved);
+            writeSectorAt(entry->sector, 0, data);
+        } else {
+            std::ofstream file;
+            file.open(getSectorFile(entry->sector).c_str(), std::ios_base::binary);
+            if (!file.is_open()) throw cannotOpenFile;
+            file << data;
+            file.close();
+        }
+    }
+    entry->size = contents.length();
+    entry->hash = hash;
+}
+
+/**
+ * @brief Write data to a virtual file
+ *
+ * @param path the path of the virtual file
+ * @param data the data to write to the file, separated by \n
+ * @return std::string the sector the file is stored in
+ */
+std::string write(const char* path, const char* data) {
+    lemlibLock lock;
+    std::string filePath = path;
+    // if the path does not start with a slash, add one
+    if (filePath.find("/") != 0) filePath = "/" + filePath;
+    // Create the file if it does not exist
+    if (!fileExists(filePath)) createFile(filePath);
+
+    std::vector<lemlibFile> index = readShardIndex(filePath);
+    lemlibFile* entry = NULL;
+    for (lemlibFile& file : index) {
+        if (file.name == filePath) entry = &file;
+    }
+    if (entry == NULL) throw fileNotFound;
+
+    // every line is terminated by a newline
+    std::string contents;
+    std::string line;
+    std::istringstream stream(data);
+    while (std::getline(stream, line, '\n')) contents += line + "\n";
+    storeFileData(index, entry, contents);
+
+    // update the metadata of the file, which only adds a line to the index file
+    entry->modified = currentTime();
+    appendShardEntry(*entry);
+
+    return entry->sector;
+}
+
+/**
+ * @brief Write data to a virtual file
+ *
+ * @param path the path of the virtual file
+ * @param data the data to write to the file, separated by \n
+ * @return std::string the sector the file is stored in
+ */
+std::string write(std::string path, std::string data) { return write(path.c_str(), data.c_str()); }
+
+/**
+ * @brief Append data to a virtual file
+ *
+ * Unlike write, the data is stored as is, so it can contain binary data. If the file has a
+ * sector that is not compressed or shared, only the new data is written. With DURABILITY_GROUP
+ * or DURABILITY_SYNC, the first append after the index was written copies the file to a new sector.
+ *
+ * @param path the path of the virtual file
+ * @param data the data to append to the file
+ */
+void append(const char* path, const std::string& data) {
+    lemlibLock lock;
+    std::string filePath = path;
+    // if the path does not start with a slash, add one
+    if (filePath.find("/") != 0) filePath = "/" + filePath;
+    // Create the file if it does not exist
+    if (!fileExists(filePath)) createFile(filePath);
+
+    std::vector<lemlibFile> index = readShardIndex(filePath);
+    lemlibFile* entry = NULL;
+    for (lemlibFile& file : index) {
+        if (file.name == filePath) entry = &file;
+    }
+    if (entry == NULL) throw fileNotFound;
+
+    if ((entry->flags & (FILE_FLAG_COMPRESSED | FILE_FLAG_INLINE)) || countSectorReferences(filePath, entry->sector) > 1 ||
+        !canWriteInPlace(entry->sector)) {
+        // the whole sector has to be rewritten, and a sector the index on the SD card uses is copied
+        storeFileData(index, entry, readFileData(*entry) + data);
+    } else if (entry->flags & FILE_FLAG_PREALLOCATED) {
+        // the end of the sector is reserved space, so the data goes after the contents
+        writeSectorAt(entry->sector, entry->size, data);
+        entry->size += data.length();
+        if (entry->hash != 0) entry->hash = hashData(data.c_str(), data.length(), entry->hash);
+    } else {
+        std::ofstream file;
+        file.open(getSectorFile(entry->sector).c_str(), std::ios_base::binary | std::ios_base::app);
+        if (!file.is_open()) throw cannotOpenFile;
+        file << data;
+        file.close();
+        entry->size += data.length();
+        // the hash can be continued from the hash of the old contents
+        if (entry->hash != 0) entry->hash = hashData(data.c_str(), data.length(), entry->hash);
+    }
+
+    // update the metadata of the file, which only adds a line to the index file
+    entry->modified = currentTime();
+    appendShardEntry(*entry);
+}
+
+/**
+ * @brief Append data to a virtual file
+ *
+ * @param path the path of the virtual file
+ * @param data the data to append to the file
+ */
+void append(std::string path, const std::string& data) { append(path.c_str(), data); }
+
+/**
+ * @brief Read data from a virtual file
+ *
+ * @param path the path of the virtual file
+ *
+ * @return std::string the data in the file, separated by \n
+ */
+std::string read(const char* path) {
+    lemlibLock lock;
+    std::string filePath = path;
+    // if the path does not start with a slash, add one
+    if (filePath.find("/") != 0) filePath = "/" + filePath;
+    // Check if it exists
+    if (!fileExists(filePath)) throw fileNotFound;
+
+    // Read the contents
+    std::string data = readFileData(stat(filePath));
+    // every line is terminated by a newline
+    if (data.length() > 0 && data[data.length() - 1] != '\n') data += "\n";
+
+    return data;
+}
+
+/**
+ * @brief Read data from a virtual file
+ *
+ * @param path the path of the virtual file
+ *
+ * @return std::string the data in the file, separated by \n
+ */
+std::string read(std::string path) { return read(path.c_str()); }
+
+/**
+ * @brief Read part of a virtual file
+ *
+ * Only the blocks of a compressed file that contain the requested bytes are decompressed.
+ *
+ * @param path the path of the virtual file
+ * @param offset the offset of the first byte to read
+ * @param length the number of bytes to read
+ *
+ * @return std::string the data, which is shorter than the length if the end of the file is reached
+ */
+std::string readAt(const char* path, unsigned long offset, unsigned long length) {
+    lemlibLock lock;
+    lemlibFile entry = stat(path);
+    if (offset >= entry.size) return "";
+    length = std::min(length, entry.size - offset);
+    if (entry.flags & FILE_FLAG_INLINE) return entry.data.substr(offset, length);
+
+    std::ifstream file;
+    file.open(getSectorFile(entry.sector).c_str(), std::ios_base::binary);
+    if (!file.is_open()) throw cannotOpenFile;
+    std::string data;
+    if (!(entry.flags & FILE_FLAG_COMPRESSED)) {
+        data.resize(length);
+        file.seekg(offset);
+        if (!file.read(&data[0], length)) throw corruptFile;
+        return data;
+    }
+    // read the header, then only the blocks that contain the data
+    std::string header(16, '\0');
+    if (!file.read(&header[0], 16)) throw corruptFile;
+    header.resize(16 + 4 * getUint32(header.c_str() + 12));
+    if (!file.read(&header[16], header.length() - 16)) throw corruptFile;
+    lemlibCompressedHeader blocks = parseCompressedHeader(header.c_str(), header.length());
+    unsigned long first = offset / blocks.blockSize;
+    unsigned long last = (offset + length - 1) / blocks.blockSize;
+    if (last + 1 >= blocks.offsets.size()) throw corruptFile;
+    for (unsigned long i = first; i <= last; i++) {
+        std::string block(blocks.offsets[i + 1] - blocks.offsets[i], '\0');
+        file.seekg(blocks.offsets[i]);
+        if (!file.read(&block[0], block.length())) throw corruptFile;
+        size_t size = std::min(blocks.blockSize, blocks.size - i * blocks.blockSize);
+        if (blocks.stored[i]) data += block;
+        else decompressBlock(block.c_str(), block.length(), data, size);
+    }
+    return data.substr(offset - first * blocks.blockSize, length);
+}
+
+/**
+ * @brief Read part of a virtual file
+ *
+ * @param path the path of the virtual file
+ * @param offset the offset of the first byte to read
+ * @param length the number of bytes to read
+ *
+ * @return std::string the data, which is shorter than the length if the end of the file is reached
+ */
+std::string readAt(std::string path, unsigned long offset, unsigned long length) {
+    return readAt(path.c_str(), offset, length);
+}
+
+/**
+ * @brief Write rows of numbers to a virtual file as text
+ *
+ * Each row is written on its own line, with its values separated by commas.
+ *
+ * @param path the path of the virtual file
+ * @param rows the rows to write
+ */
+void writeTextRecords(const char* path, const std::vector<std::vector<double> >& rows) {
+    std::string data;
+    for (const std::vector<double>& row : rows) {
+        for (size_t i = 0; i < row.size(); i++) {
+            if (i > 0) data += ",";
+            data += to_string(row[i]);
+        }
+        data += "\n";
+    }
+    write(path, data.c_str());
+}
+
+/**
+ * @brief Write rows of numbers to a virtual file as text
+ *
+ * @param path the path of the virtual file
+ * @param rows the rows to write
+ */
+void writeTextRecords(std::string path, const std::vector<std::vector<double> >& rows) {
+    writeTextRecords(path.c_str(), rows);
+}
+
+/**
+ * @brief Read rows of numbers from a virtual file written as text
+ *
+ * Values can be separated by commas or whitespace. Empty lines are skipped.
+ *
+ * @param path the path of the virtual file
+ * @return std::vector<std::vector<double>> the rows in the file
+ */
+std::vector<std::vector<double> > readTextRecords(const char* path) {
+    std::string data = read(path);
+    std::vector<std::vector<double> > rows;
+    std::vector<double> row;
+    const char* pos = data.c_str();
+    while (*pos != '\0') {
+        if (*pos == '\n') {
+            if (row.size() > 0) rows.push_back(row);
+            row.clear();
+            pos++;
+        } else if (*pos == ',' || *pos == ' ' || *pos == '\t' || *pos == '\r') {
+            pos++;
+        } else {
+            const char* end;
+            row.push_back(parseDouble(pos, &end));
+            if (end == pos) throw corruptFile;
+            pos = end;
+        }
+    }
+    if (row.size() > 0) rows.push_back(row);
+    return rows;
+}
+
+/**
+ * @brief Read rows of numbers from a virtual file written as text
+ *
+ * @param path the path of the virtual file
+ * @return std::vector<std::vector<double>> the rows in the file
+ */
+std::vector<std::vector<double> > readTextRecords(std::string path) { return readTextRecords(path.c_str()); }
+
+/**
+ * @brief Type codes of the fields of a record file
+ *
+ * The low nibble is the size of the field in bytes.
+ */
+const unsigned char RECORD_FIELD_SIGNED = 0x10;
+const unsigned char RECORD_FIELD_FLOAT = 0x20;
+
+/**
+ * @brief Get the type code of a record field
+ *
+ * @tparam T the type of the field, which must be an integer or floating point type
+ * @return unsigned char the type code
+ */
+template <typename T> unsigned char getRecordFieldType() {
+    static_assert(std::is_arithmetic<T>::value && sizeof(T) <= 8, "record fields must be numbers");
+    if (std::is_floating_point<T>::value) return RECORD_FIELD_FLOAT | sizeof(T);
+    return (std::is_signed<T>::value ? RECORD_FIELD_SIGNED : 0) | sizeof(T);
+}
+
+/**
+ * @brief Encode a record field
+ *
+ * Values are passed as 64 bits: integers sign or zero extended, and floating point numbers
+ * as their bit pattern. Without delta encoding, the field is stored with its own size.
+ * With delta encoding, integers are stored as the zigzag varint of the difference to the
+ * previous record, and floating point numbers as the varint of their bits xor the previous
+ * bits, which only saves the bits that did not change.
+ *
+ * @param out the string to append the field to
+ * @param type the type code of the field
+ * @param bits the value of the field
+ * @param previous the value of the field in the previous record
+ * @param delta whether delta encoding is used
+ */
+void encodeRecordField(std::string& out, unsigned char type, unsigned long long bits, unsigned long long previous,
+                       bool delta) {
+    if (!delta) {
+        for (int i = 0; i < (type & 0xf); i++) out += (char)((bits >> (8 * i)) & 0xff);
+    } else if (type & RECORD_FIELD_FLOAT) {
+        putVarint(out, bits ^ previous);
+    } else {
+        long long difference = (long long)(bits - previous);
+        putVarint(out, ((unsigned long long)difference << 1) ^ (unsigned long long)(difference >> 63));
+    }
+}
+
+/**
+ * @brief Decode a record field encoded with encodeRecordField
+ *
+ * @param data the data to read from
+ * @param pos the position of the field, moved past it
+ * @param length the length of the data
+ * @param type the type code of the field
+ * @param previous the value of the field in the previous record
+ * @param delta whether delta encoding is used
+ * @return unsigned long long the value of the field
+ */
+unsigned long long decodeRecordField(const char* data, size_t& pos, size_t length, unsigned char type,
+                                     unsigned long long previous, bool delta) {
+    int size = type & 0xf;
+    unsigned long long bits = 0;
+    if (!delta) {
+        if (length - pos < (size_t)size) throw corruptFile;
+        for (int i = size - 1; i >= 0; i--) bits = (bits << 8) | (unsigned char)data[pos + i];
+        pos += size;
+    } else if (type & RECORD_FIELD_FLOAT) {
+        return getVarint(data, pos, length) ^ previous;
+    } else {
+        unsigned long long zigzag = getVarint(data, pos, length);
+        bits = previous + ((zigzag >> 1) ^ (0 - (zigzag & 1)));
+    }
+    // sign extend integers that are smaller than 64 bits
+    if (size < 8 && (type & RECORD_FIELD_SIGNED) && !(type & RECORD_FIELD_FLOAT)) {
+        bits &= (1ULL << (8 * size)) - 1;
+        if (bits >> (8 * size - 1)) bits |= ~0ULL << (8 * size);
+    }
+    return bits;
+}
+
+/**
+ * @brief Convert a record field to the 64 bits it is encoded from
+ *
+ * @param value the value of the field
+ * @return unsigned long long the bits of the field
+ */
+template <typename T> unsigned long long recordFieldToBits(T value) {
+    if (std::is_floating_point<T>::value) {
+        unsigned long long bits = 0;
+        memcpy(&bits, &value, sizeof(T));
+        return bits;
+    }
+    return (unsigned long long)(long long)value;
+}
+
+/**
+ * @brief Convert the 64 bits of a record field back to its value
+ *
+ * @param bits the bits of the field
+ * @return T the value of the field
+ */
+template <typename T> T recordFieldFromBits(unsigned long long bits) {
+    T value;
+    if (std::is_floating_point<T>::value) memcpy(&value, &bits, sizeof(T));
+    else value = (T)bits;
+    return value;
+}
+
+/**
+ * @brief Encodes and decodes the first I fields of a record
+ *
+ * @tparam I the number of fields to process
+ * @tparam Fields the types of the fields of the record
+ */
+template <size_t I, typename... Fields> struct lemlibRecordCodec {
+        typedef std::tuple<Fields...> Record;
+        typedef typename std::tuple_element<I - 1, Record>::type Field;
+
+        static void encode(std::string& out, const Record& record, const Record& previous, bool delta) {
+            lemlibRecordCodec<I - 1, Fields...>::encode(out, record, previous, delta);
+            encodeRecordField(out, getRecordFieldType<Field>(), recordFieldToBits(std::get<I - 1>(record)),
+                              recordFieldToBits(std::get<I - 1>(previous)), delta);
+        }
+
+        static void decode(const char* data, size_t& pos, size_t length, Record& record, bool delta) {
+            lemlibRecordCodec<I - 1, Fields...>::decode(data, pos, length, record, delta);
+            unsigned long long bits = decodeRecordField(data, pos, length, getRecordFieldType<Field>(),
+                                                        recordFieldToBits(std::get<I - 1>(record)), delta);
+            std::get<I - 1>(record) = recordFieldFromBits<Field>(bits);
+        }
+
+        static void types(std::string& out) {
+            lemlibRecordCodec<I - 1, Fields...>::types(out);
+            out += (char)getRecordFieldType<Field>();
+        }
+};
+
+template <typename... Fields> struct lemlibRecordCodec<0, Fields...> {
+        static void encode(std::string&, const std::tuple<Fields...>&, const std::tuple<Fields...>&, bool) {}
+
+        static void decode(const char*, size_t&, size_t, std::tuple<Fields...>&, bool) {}
+
+        static void types(std::string&) {}
+};
+
+/**
+ * @brief Get the header of a record file
+ *
+ * The header is "LREC", the version, whether delta encoding is used, the number of fields
+ * and the type code of each field.
+ *
+ * @param types the type codes of the fields
+ * @param delta whether delta encoding is used
+ * @return std::string the header
+ */
+std::string getRecordHeader(const std::string& types, bool delta) {
+    std::string header = "LREC";
+    header += (char)1;
+    header += (char)(delta ? 1 : 0);
+    header += (char)types.length();
+    return header + types;
+}
+
+/**
+ * @brief A file of binary records with a fixed schema
+ *
+ * Records are encoded in memory, and appended to the file when flush is called or the buffer
+ * is full, so appending a record does not touch the file system.
+ *
+ * @tparam Fields the types of the fields of each record
+ */
+template <typename... Fields> class lemlibRecordFile {
+    public:
+        typedef std::tuple<Fields...> Record;
+
+        /**
+         * @brief Open a record file, creating it if it does not exist
+         *
+         * @param path the path of the virtual file
+         * @param delta whether to use delta encoding, which only applies to new files
+         */
+        lemlibRecordFile(const char* path, bool delta = false)
+            : path(path),
+              delta(delta),
+              previous() {
+            std::string types;
+            lemlibRecordCodec<sizeof...(Fields), Fields...>::types(types);
+            if (!fileExists(path) || stat(path).size == 0) {
+                buffer = getRecordHeader(types, delta);
+                flush();
+                return;
+            }
+            // check that the file has the same schema
+            std::string header = readAt(path, 0, 7 + types.length());
+            if (header.length() < 7) throw corruptFile;
+            this->delta = header[5] != 0;
+            if (header != getRecordHeader(types, this->delta)) throw schemaMismatch;
+            // delta encoding continues from the last record in the file
+            if (this->delta) {
+                std::vector<Record> records = readRecords();
+                if (records.size() > 0) previous = records.back();
+            }
+        }
+
+        /**
+         * @brief Flush the remaining records
+         *
+         */
+        ~lemlibRecordFile() {
+            try {
+                flush();
+            } catch (...) {}
+        }
+
+        /**
+         * @brief Append a record
+         *
+         * @param values the fields of the record
+         */
+        void append(const Fields&... values) {
+            Record record(values...);
+            lemlibRecordCodec<sizeof...(Fields), Fields...>::encode(buffer, record, previous, delta);
+            previous = record;
+            if (buffer.length() >= 4096) flush();
+        }
+
+        /**
+         * @brief Write the buffered records to the file
+         *
+         */
+        void flush() {
+            if (buffer.length() == 0) return;
+            ::append(path, buffer);
+            buffer.clear();
+        }
+
+        /**
+         * @brief Read every record in the file, including buffered records
+         *
+         * @return std::vector<Record> the records
+         */
+        std::vector<Record> readRecords() {
+            flush();
+            std::string data = readFileData(stat(path));
+            std::string types;
+            lemlibRecordCodec<sizeof...(Fields), Fields...>::types(types);
+            size_t pos = 7 + types.length();
+            if (data.length() < pos) throw corruptFile;
+            std::vector<Record> records;
+            Record record = Record();
+            while (pos < data.length()) {
+                lemlibRecordCodec<sizeof...(Fields), Fields...>::decode(data.c_str(), pos, data.length(), record,
+                                                                        delta);
+                records.push_back(record);
+            }
+            return records;
+        }
+
+        /**
+         * @brief Read one field of every record in the file
+         *
+         * @tparam I the index of the field
+         * @return std::vector the values of the field
+         */
+        template <size_t I> std::vector<typename std::tuple_element<I, Record>::type> readField() {
+            std::vector<Record> records = readRecords();
+            std::vector<typename std::tuple_element<I, Record>::type> values;
+            values.reserve(records.size());
+            for (const Record& record : records) values.push_back(std::get<I>(record));
+            return values;
+        }
+    private:
+        std::string path;
+        bool delta;
+        std::string buffer;
+        Record previous;
+};
+
+/**
+ * @brief Format a decoded record field as text
+ *
+ * @param type the type code of the field
+ * @param bits the value of the field
+ * @return std::string the value as text
+ */
+std::string formatRecordField(unsigned char type, unsigned long long bits) {
+    if (type == (RECORD_FIELD_FLOAT | 4)) return to_string(recordFieldFromBits<float>(bits));
+    if (type == (RECORD_FIELD_FLOAT | 8)) return to_string(recordFieldFromBits<double>(bits));
+    if (type & RECORD_FIELD_SIGNED) return to_string((long long)bits);
+    return to_string(bits);
+}
+
+/**
+ * @brief Size of the part of a ring file header that follows the field types
+ *
+ * This is the capacity, the record size, the slot the next record is written to, and the
+ * number of records, each stored as 32 bits.
+ */
+const size_t RING_HEADER_COUNTERS = 16;
+
+/**
+ * @brief Read a ring file without knowing its schema
+ *
+ * @param data the contents of the ring file
+ * @return std::vector<std::string> every record from oldest to newest, with its fields separated by commas
+ */
+std::vector<std::string> readRingFileAsText(const std::string& data) {
+    if (data.length() < 7) throw corruptFile;
+    std::string types = data.substr(7, (unsigned char)data[6]);
+    size_t headerSize = 7 + types.length() + RING_HEADER_COUNTERS;
+    if (data.length() < headerSize) throw corruptFile;
+    const char* counters = data.c_str() + 7 + types.length();
+    unsigned long capacity = getUint32(counters);
+    unsigned long recordSize = getUint32(counters + 4);
+    unsigned long head = getUint32(counters + 8);
+    unsigned long count = getUint32(counters + 12);
+    if (count > capacity || head >= capacity || data.length() < headerSize + capacity * recordSize) throw corruptFile;
+    std::vector<std::string> records;
+    for (unsigned long i = 0; i < count; i++) {
+        size_t pos = headerSize + ((head + capacity - count + i) % capacity) * recordSize;
+        std::string record;
+        for (size_t j = 0; j < types.length(); j++) {
+            if (j > 0) record += ",";
+            record += formatRecordField(types[j], decodeRecordField(data.c_str(), pos, data.length(), types[j], 0, false));
+        }
+        records.push_back(record);
+    }
+    return records;
+}
+
+/**
+ * @brief Read a record or ring file without knowing its schema
+ *
+ * @param path the path of the virtual file
+ * @return std::vector<std::string> every record, with its fields separated by commas
+ */
+std::vector<std::string> readRecordFileAsText(const char* path) {
+    lemlibLock lock;
+    std::string data = readFileData(stat(path));
+    if (data.length() >= 4 && data.compare(0, 4, "LRNG") == 0) return readRingFileAsText(data);
+    if (data.length() < 7 || data.compare(0, 4, "LREC") != 0) throw corruptFile;
+    bool delta = data[5] != 0;
+    std::string types = data.substr(7, (unsigned char)data[6]);
+    if (types.length() != (unsigned char)data[6]) throw corruptFile;
+    std::vector<unsigned long long> previous(types.length(), 0);
+    std::vector<std::string> records;
+    size_t pos = 7 + types.length();
+    while (pos < data.length()) {
+        std::string record;
+        for (size_t i = 0; i < types.length(); i++) {
+            previous[i] = decodeRecordField(data.c_str(), pos, data.length(), types[i], previous[i], delta);
+            if (i > 0) record += ",";
+            record += formatRecordField(types[i], previous[i]);
+        }
+        records.push_back(record);
+    }
+    return records;
+}
+
+/**
+ * @brief A file of fixed size records that overwrites its oldest records when full
+ *
+ * The sector is allocated at its full size when the file is created, and records are written
+ * in place. The header after the field types holds the capacity, the record size, the slot the
+ * next record is written to, and the number of records, so appending a record writes the
+ * record and 8 bytes of the header.
+ *
+ * @tparam Fields the types of the fields of each record
+ */
+template <typename... Fields> class lemlibRingFile {
+    public:
+        typedef std::tuple<Fields...> Record;
+
+        /**
+         * @brief Open a ring file, creating it if it does not exist
+         *
+         * @param path the path of the virtual file
+         * @param capacity the number of records the file holds, which only applies to new files
+         */
+        lemlibRingFile(const char* path, unsigned long capacity)
+            : path(path),
+              capacity(capacity),
+              recordSize(0),
+              head(0),
+              count(0) {
+            // if the path does not start with a slash, add one, so it matches its index entry
+            if (this->path.find("/") != 0) this->path = "/" + this->path;
+            std::string types;
+            lemlibRecordCodec<sizeof...(Fields), Fields...>::types(types);
+            for (size_t i = 0; i < types.length(); i++) recordSize += types[i] & 0xf;
+            headerSize = 7 + types.length() + RING_HEADER_COUNTERS;
+            if (!fileExists(path) || stat(path).size == 0) create(types);
+            open(types);
+        }
+
+        /**
+         * @brief Close the ring file
+         *
+         */
+        ~lemlibRingFile() {
+            try {
+                close();
+            } catch (...) {}
+        }
+
+        /**
+         * @brief Append a record, overwriting the oldest record if the file is full
+         *
+         * @param values the fields of the record
+         */
+        void append(const Fields&... values) {
+            // copy the sector before writing to it if it became shared
+            if (generation != sharingGeneration) reopen();
+            std::string record;
+            lemlibRecordCodec<sizeof...(Fields), Fields...>::encode(record, Record(values...), Record(), false);
+            file.seekp(headerSize + head * recordSize);
+            file.write(record.c_str(), record.length());
+            head = (head + 1) % capacity;
+            if (count < capacity) count++;
+            std::string counters;
+            putUint32(counters, head);
+            putUint32(counters, count);
+            file.seekp(headerSize - 8);
+            file.write(counters.c_str(), counters.length());
+            if (!file) throw cannotOpenFile;
+        }
+
+        /**
+         * @brief Write the appended records to the SD card
+         *
+         */
+        void flush() { file.flush(); }
+
+        /**
+         * @brief Read every record in the file, from oldest to newest
+         *
+         * @return std::vector<Record> the records
+         */
+        std::vector<Record> readRecords() {
+            flush();
+            std::string data = readSector(sector);
+            if (data.length() < headerSize + capacity * recordSize) throw corruptFile;
+            std::vector<Record> records;
+            for (unsigned long i = 0; i < count; i++) {
+                size_t pos = headerSize + ((head + capacity - count + i) % capacity) * recordSize;
+                Record record = Record();
+                lemlibRecordCodec<sizeof...(Fields), Fields...>::decode(data.c_str(), pos, data.length(), record,
+                                                                        false);
+                records.push_back(record);
+            }
+            return records;
+        }
+
+        /**
+         * @brief Read one field of every record in the file, from oldest to newest
+         *
+         * @tparam I the index of the field
+         * @return std::vector the values of the field
+         */
+        template <size_t I> std::vector<typename std::tuple_element<I, Record>::type> readField() {
+            std::vector<Record> records = readRecords();
+            std::vector<typename std::tuple_element<I, Record>::type> values;
+            values.reserve(records.size());
+            for (const Record& record : records) values.push_back(std::get<I>(record));
+            return values;
+        }
+
+        /**
+         * @brief Close the sector and update the modification time of the file
+         *
+         */
+        void close() {
+            if (!file.is_open()) return;
+            lemlibLock lock;
+            closeSector();
+            std::vector<lemlibFile> index = readShardIndex(path);
+            for (lemlibFile& entry : index) {
+                if (entry.name == path) entry.modified = currentTime();
+            }
+            writeShardIndex(path, index);
+        }
+    private:
+        std::string path;
+        std::string sector;
+        std::fstream file;
+        unsigned long capacity;
+        unsigned long recordSize;
+        unsigned long headerSize;
+        unsigned long head;
+        unsigned long count;
+        unsigned long generation;
+
+        /**
+         * @brief Allocate the sector of a new ring file at its full size
+         *
+         * @param types the type codes of the fields
+         */
+        void create(const std::string& types) {
+            lemlibLock lock;
+            if (capacity == 0) throw schemaMismatch;
+            if (!fileExists(path)) createFile(path);
+            std::string data = getRecordHeader(types, false);
+            data[0] = 'L', data[1] = 'R', data[2] = 'N', data[3] = 'G';
+            putUint32(data, capacity);
+            putUint32(data, recordSize);
+            putUint32(data, 0);
+            putUint32(data, 0);
+            data.resize(headerSize + capacity * recordSize, '\0');
+            std::vector<lemlibFile> index = readShardIndex(path);
+            for (lemlibFile& entry : index) {
+                if (entry.name != path) continue;
+                entry.flags = FILE_FLAG_RING;
+                storeFileData(index, &entry, data);
+                // the contents change in place, so the hash is not kept
+                entry.hash = 0;
+            }
+            writeShardIndex(path, index);
+        }
+
+        /**
+         * @brief Open the sector of the ring file, copying it first if it is shared
+         *
+         * @param types the type codes of the fields
+         */
+        void open(const std::string& types) {
+            lemlibLock lock;
+            std::string header = readAt(path, 0, headerSize);
+            if (header.length() < headerSize || header.compare(0, 4, "LRNG") != 0 ||
+                header.compare(4, 3 + types.length(), getRecordHeader(types, false), 4, 3 + types.length()) != 0) {
+                throw schemaMismatch;
+            }
+            const char* counters = header.c_str() + headerSize - RING_HEADER_COUNTERS;
+            capacity = getUint32(counters);
+            if (capacity == 0 || getUint32(counters + 4) != recordSize) throw corruptFile;
+            head = getUint32(counters + 8);
+            count = getUint32(counters + 12);
+            std::vector<lemlibFile> index = readShardIndex(path);
+            for (lemlibFile& entry : index) {
+                if (entry.name != path) continue;
+                if (!(entry.flags & FILE_FLAG_RING)) throw schemaMismatch;
+                if (countSectorReferences(path, entry.sector) > 1) {
+                    storeFileData(index, &entry, readFileData(entry));
+                    entry.hash = 0;
+                    writeShardIndex(path, index);
+                }
+                sector = entry.sector;
+            }
+            file.open(getSectorFile(sector).c_str(), std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+            if (!file.is_open()) throw cannotOpenFile;
+            pinSector(sector);
+            // only set once the sector is open, so a failed reopen is tried again on the next append
+            generation = sharingGeneration;
+        }
+
+        /**
+         * @brief Close the sector, writing the buffered records to it before it can be reused
+         *
+         */
+        void closeSector() {
+            if (!file.is_open()) return;
+            lemlibLock lock;
+            file.close();
+            unpinSector(sector);
+        }
+
+        /**
+         * @brief Reopen the sector after it became shared or freed
+         *
+         */
+        void reopen() {
+            closeSector();
+            std::string types;
+            lemlibRecordCodec<sizeof...(Fields), Fields...>::types(types);
+            open(types);
+        }
+};
+
+/**
+ * @brief Convert a decoded record field to a double
+ *
+ * @param type the type code of the field
+ * @param bits the value of the field
+ * @return double the value of the field
+ */
+double recordFieldToDouble(unsigned char type, unsigned long long bits) {
+    if (type == (RECORD_FIELD_FLOAT | 4)) return recordFieldFromBits<float>(bits);
+    if (type == (RECORD_FIELD_FLOAT | 8)) return recordFieldFromBits<double>(bits);
+    if (type & RECORD_FIELD_SIGNED) return (double)(long long)bits;
+    return (double)bits;
+}
+
+/**
+ * @brief A block of one column in a column file
+ *
+ * @param column the index of the column
+ * @param offset the offset of the block in the file
+ * @param rows the number of values in the block
+ * @param min the smallest value in the block
+ * @param max the largest value in the block
+ */
+typedef struct lemlibColumnBlock {
+        unsigned long column;
+        unsigned long offset;
+        unsigned long rows;
+        double min;
+        double max;
+} lemlibColumnBlock;
+
+/**
+ * @brief The footer of a column file
+ *
+ * @param names the names of the columns
+ * @param types the type codes of the columns
+ * @param blocks every block in the file, in the order they were written
+ */
+typedef struct lemlibColumnFooter {
+        std::vector<std::string> names;
+        std::string types;
+        std::vector<lemlibColumnBlock> blocks;
+} lemlibColumnFooter;
+
+/**
+ * @brief Encode the footer of a column file
+ *
+ * The footer holds the number of columns, the type code, name length and name of each column,
+ * the number of blocks, and the column, offset, row count, minimum and maximum of each block.
+ * It is followed by the offset of the footer and "LCOL", so it can be found from the end of the file.
+ *
+ * @param footer the footer to encode
+ * @param offset the offset the footer is written at
+ * @return std::string the encoded footer
+ */
+std::string encodeColumnFooter(const lemlibColumnFooter& footer, unsigned long offset) {
+    std::string out;
+    putUint32(out, footer.names.size());
+    for (size_t i = 0; i < footer.names.size(); i++) {
+        out += footer.types[i];
+        out += (char)footer.names[i].length();
+        out += footer.names[i];
+    }
+    putUint32(out, footer.blocks.size());
+    for (const lemlibColumnBlock& block : footer.blocks) {
+        out += (char)block.column;
+        putUint32(out, block.offset);
+        putUint32(out, block.rows);
+        encodeRecordField(out, RECORD_FIELD_FLOAT | 8, recordFieldToBits(block.min), 0, false);
+        encodeRecordField(out, RECORD_FIELD_FLOAT | 8, recordFieldToBits(block.max), 0, false);
+    }
+    putUint32(out, offset);
+    return out + "LCOL";
+}
+
+/**
+ * @brief Read the footer of a column file
+ *
+ * Only the end of the file is read.
+ *
+ * @param path the path of the virtual file
+ * @param offset set to the offset of the footer
+ * @return lemlibColumnFooter the footer
+ */
+lemlibColumnFooter readColumnFooter(const char* path, unsigned long& offset) {
+    unsigned long size = stat(path).size;
+    if (size < 13) throw corruptFile;
+    std::string trailer = readAt(path, size - 8, 8);
+    if (trailer.compare(4, 4, "LCOL") != 0) throw corruptFile;
+    offset = getUint32(trailer.c_str());
+    if (offset < 5 || offset > size - 8) throw corruptFile;
+    std::string data = readAt(path, offset, size - 8 - offset);
+    size_t pos = 0;
+    lemlibColumnFooter footer;
+    if (data.length() < 4) throw corruptFile;
+    unsigned long columns = getUint32(data.c_str());
+    pos += 4;
+    for (unsigned long i = 0; i < columns; i++) {
+        if (data.length() - pos < 2 || data.length() - pos - 2 < (unsigned char)data[pos + 1]) throw corruptFile;
+        footer.types += data[pos];
+        footer.names.push_back(data.substr(pos + 2, (unsigned char)data[pos + 1]));
+        pos += 2 + (unsigned char)data[pos + 1];
+    }
+    if (data.length() - pos < 4) throw corruptFile;
+    unsigned long blocks = getUint32(data.c_str() + pos);
+    pos += 4;
+    for (unsigned long i = 0; i < blocks; i++) {
+        if (data.length() - pos < 25) throw corruptFile;
+        lemlibColumnBlock block;
+        block.column = (unsigned char)data[pos];
+        block.offset = getUint32(data.c_str() + pos + 1);
+        block.rows = getUint32(data.c_str() + pos + 5);
+        pos += 9;
+        block.min = recordFieldFromBits<double>(
+            decodeRecordField(data.c_str(), pos, data.length(), RECORD_FIELD_FLOAT | 8, 0, false));
+        block.max = recordFieldFromBits<double>(
+            decodeRecordField(data.c_str(), pos, data.length(), RECORD_FIELD_FLOAT | 8, 0, false));
+        if (block.column >= columns) throw corruptFile;
+        footer.blocks.push_back(block);
+    }
+    return footer;
+}
+
+/**
+ * @brief Find a column of a column file by name
+ *
+ * @param footer the footer of the column file
+ * @param name the name of the column
+ * @return size_t the index of the column
+ */
+size_t findColumn(const lemlibColumnFooter& footer, const std::string& name) {
+    for (size_t i = 0; i < footer.names.size(); i++) {
+        if (footer.names[i] == name) return i;
+    }
+    throw fileNotFound;
+}
+
+/**
+ * @brief Read one column of a column file
+ *
+ * Only the footer and the blocks of the column are read.
+ *
+ * @param path the path of the virtual file
+ * @param name the name of the column
+ * @param min only blocks that can contain values of at least this are read
+ * @param max only blocks that can contain values of at most this are read
+ * @return std::vector<double> the values in the column
+ */
+std::vector<double> readColumn(const char* path, const char* name, double min = -HUGE_VAL, double max = HUGE_VAL) {
+    unsigned long offset;
+    lemlibColumnFooter footer = readColumnFooter(path, offset);
+    size_t column = findColumn(footer, name);
+    unsigned char type = footer.types[column];
+    std::vector<double> values;
+    for (const lemlibColumnBlock& block : footer.blocks) {
+        // skip blocks whose values are all out of range
+        if (block.column != column || block.max < min || block.min > max) continue;
+        std::string data = readAt(path, block.offset, block.rows * (type & 0xf));
+        size_t pos = 0;
+        for (unsigned long i = 0; i < block.rows; i++) {
+            values.push_back(recordFieldToDouble(type, decodeRecordField(data.c_str(), pos, data.length(), type, 0, false)));
+        }
+    }
+    return values;
+}
+
+/**
+ * @brief Get the range of a column of a column file from the block statistics
+ *
+ * @param path the path of the virtual file
+ * @param name the name of the column
+ * @param min set to the smallest value in the column
+ * @param max set to the largest value in the column
+ */
+void getColumnRange(const char* path, const char* name, double& min, double& max) {
+    unsigned long offset;
+    lemlibColumnFooter footer = readColumnFooter(path, offset);
+    size_t column = findColumn(footer, name);
+    min = HUGE_VAL;
+    max = -HUGE_VAL;
+    for (const lemlibColumnBlock& block : footer.blocks) {
+        if (block.column != column) continue;
+        min = std::min(min, block.min);
+        max = std::max(max, block.max);
+    }
+}
+
+/**
+ * @brief A file that stores each field of its rows in its own sequence of blocks
+ *
+ * Rows are split into columns in memory. When a block of rows is complete, each column is appended
+ * to the file as one block. The footer with the statistics of every block is written when the file
+ * is closed, so reading a column only reads the footer and the blocks of that column.
+ *
+ * @tparam Fields the types of the fields of each row
+ */
+template <typename... Fields> class lemlibColumnFile {
+    public:
+        typedef std::tuple<Fields...> Row;
+
+        /**
+         * @brief Open a column file, creating it if it does not exist
+         *
+         * @param path the path of the virtual file
+         * @param names the names of the columns
+         * @param rowsPerBlock the number of rows in each block
+         */
+        lemlibColumnFile(const char* path, const std::vector<std::string>& names, unsigned long rowsPerBlock = 256)
+            : path(path),
+              rowsPerBlock(rowsPerBlock),
+              rows(0),
+              columns(sizeof...(Fields)) {
+            footer.names = names;
+            lemlibRecordCodec<sizeof...(Fields), Fields...>::types(footer.types);
+            if (names.size() != sizeof...(Fields) || rowsPerBlock == 0) throw schemaMismatch;
+            if (!fileExists(path) || stat(path).size == 0) {
+                ::append(path, "LCOL\1");
+                end = 5;
+                return;
+            }
+            // new blocks are written over the old footer
+            lemlibColumnFooter existing = readColumnFooter(path, end);
+            if (existing.names != footer.names || existing.types != footer.types) throw schemaMismatch;
+            footer.blocks = existing.blocks;
+            std::string contents = readAt(path, 0, end);
+            std::string name = stat(path).name;
+            std::vector<lemlibFile> index = readShardIndex(name);
+            for (lemlibFile& entry : index) {
+                if (entry.name == name) storeFileData(index, &entry, contents);
+            }
+            writeShardIndex(name, index);
+        }
+
+        /**
+         * @brief Write the remaining rows and the footer
+         *
+         */
+        ~lemlibColumnFile() {
+            try {
+                close();
+            } catch (...) {}
+        }
+
+        /**
+         * @brief Append a row
+         *
+         * @param values the fields of the row
+         */
+        void append(const Fields&... values) {
+            std::string row;
+            lemlibRecordCodec<sizeof...(Fields), Fields...>::encode(row, Row(values...), Row(), false);
+            // split the row into its columns
+            size_t pos = 0;
+            for (size_t i = 0; i < columns.size(); i++) {
+                unsigned char type = footer.types[i];
+                size_t start = pos;
+                double value = recordFieldToDouble(type, decodeRecordField(row.c_str(), pos, row.length(), type, 0, false));
+                columns[i].data.append(row, start, pos - start);
+                if (rows == 0 || value < columns[i].min) columns[i].min = value;
+                if (rows == 0 || value > columns[i].max) columns[i].max = value;
+            }
+            if (++rows == rowsPerBlock) flush();
+        }
+
+        /**
+         * @brief Write the rows of the current block, even if it is not complete
+         *
+         */
+        void flush() {
+            if (rows == 0) return;
+            std::string data;
+            for (size_t i = 0; i < columns.size(); i++) {
+                lemlibColumnBlock block = {i, end + data.length(), rows, columns[i].min, columns[i].max};
+                footer.blocks.push_back(block);
+                data += columns[i].data;
+                columns[i].data.clear();
+            }
+            ::append(path, data);
+            end += data.length();
+            rows = 0;
+        }
+
+        /**
+         * @brief Write the remaining rows and the footer
+         *
+         * The file can be opened again to append more rows.
+         */
+        void close() {
+            if (path == "") return;
+            flush();
+            ::append(path, encodeColumnFooter(footer, end));
+            path = "";
+        }
+    private:
+        /**
+         * @brief The values of one column in the current block
+         *
+         */
+        struct Column {
+                std::string data;
+                double min;
+                double max;
+        };
+
+        std::string path;
+        unsigned long rowsPerBlock;
+        unsigned long rows;
+        unsigned long end;
+        std::vector<Column> columns;
+        lemlibColumnFooter footer;
+};
+
+/**
+ * @brief A logger that writes to the file system from a background task
+ *
+ * Data is copied into one of two preallocated buffers. When it is full, or the flush interval
+ * has passed, the buffers are swapped and the background task appends the full buffer to the
+ * file. Logging never blocks or allocates: if the background task has not finished writing
+ * the other buffer yet, the data is dropped and counted.
+ *
+ * Only one task should log to a logger.
+ */
+class lemlibLogger {
+    public:
+        /**
+         * @brief Start a logger
+         *
+         * @param path the path of the virtual file to append to
+         * @param bufferSize the size of each buffer in bytes
+         * @param interval the time between writes in milliseconds
+         */
+        lemlibLogger(const char* path, size_t bufferSize = 4096, unsigned long interval = 100)
+            : path(path),
+              capacity(bufferSize),
+              interval(interval),
+              active(0),
+              fill(0),
+              running(true),
+              swapRequested(false),
+              dropped(0),
+              task(NULL) {
+            buffers[0] = new char[capacity];
+            buffers[1] = new char[capacity];
+            pending[0].store(0);
+            pending[1].store(0);
+            task = new lemlibTask(drain, this);
+        }
+
+        lemlibLogger(const lemlibLogger&) = delete;
+
+        lemlibLogger& operator=(const lemlibLogger&) = delete;
+
+        /**
+         * @brief Stop the logger and write the remaining data
+         *
+         */
+        ~lemlibLogger() {
+            try {
+                stop();
+            } catch (...) {}
+            delete[] buffers[0];
+            delete[] buffers[1];
+        }
+
+        /**
+         * @brief Log data
+         *
+         * @param data the data to log
+         * @param length the length of the data
+         * @return true the data was logged
+         * @return false the data was dropped because both buffers are full
+         */
+        bool log(const char* data, size_t length) {
+            if (length > capacity || task == NULL) {
+                dropped++;
+                return false;
+            }
+            // hand the buffer to the background task if it asked for it
+            if (swapRequested.load(std::memory_order_relaxed) && fill > 0) swap();
+            if (capacity - fill < length && !swap()) {
+                dropped++;
+                return false;
+            }
+            memcpy(buffers[active] + fill, data, length);
+            fill += length;
+            return true;
+        }
+
+        /**
+         * @brief Log data
+         *
+         * @param data the data to log
+         * @return true the data was logged
+         * @return false the data was dropped because both buffers are full
+         */
+        bool log(const std::string& data) { return log(data.c_str(), data.length()); }
+
+        /**
+         * @brief Get the number of times data was dropped
+         *
+         * @return unsigned long the number of dropped calls to log, and of buffers that could not be written
+         */
+        unsigned long getDropped() { return dropped.load(); }
+
+        /**
+         * @brief Stop the background task and write the remaining data
+         *
+         * This must be called from the task that logs.
+         */
+        void stop() {
+            if (task == NULL) return;
+            running.store(false);
+            task->join();
+            delete task;
+            task = NULL;
+            writePending();
+            if (fill > 0) ::append(path, std::string(buffers[active], fill));
+            fill = 0;
+        }
+    private:
+        std::string path;
+        char* buffers[2];
+        size_t capacity;
+        unsigned long interval;
+        // only used by the task that logs
+        int active;
+        size_t fill;
+        // the number of bytes in each buffer waiting to be written, or 0 if the buffer is free
+        std::atomic<size_t> pending[2];
+        std::atomic<bool> running;
+        std::atomic<bool> swapRequested;
+        std::atomic<unsigned long> dropped;
+        lemlibTask* task;
+
+        /**
+         * @brief Hand the active buffer to the background task
+         *
+         * @return true the buffers were swapped
+         * @return false the other buffer has not been written yet
+         */
+        bool swap() {
+            int other = 1 - active;
+            if (pending[other].load(std::memory_order_acquire) != 0) return false;
+            pending[active].store(fill, std::memory_order_release);
+            active = other;
+            fill = 0;
+            swapRequested.store(false, std::memory_order_relaxed);
+            return true;
+        }
+
+        /**
+         * @brief Write the buffers that were handed to the background task
+         *
+         * A buffer that could not be written, such as when the SD card is full or removed, stays
+         * pending and is written again on the next pass. The failure is counted as dropped.
+         */
+        void writePending() {
+            for (int i = 0; i < 2; i++) {
+                size_t length = pending[i].load(std::memory_order_acquire);
+                if (length == 0) continue;
+                // an exception can not leave the background task, or the program is terminated
+                try {
+                    ::append(path, std::string(buffers[i], length));
+                } catch (...) {
+                    dropped++;
+                    return;
+                }
+                pending[i].store(0, std::memory_order_release);
+            }
+        }
+
+        /**
+         * @brief Body of the background task
+         *
+         * @param self the logger
+         */
+        static void drain(void* self) {
+            lemlibLogger* logger = (lemlibLogger*)self;
+            while (logger->running.load()) {
+                sleepMillis(logger->interval);
+                logger->swapRequested.store(true, std::memory_order_relaxed);
+                logger->writePending();
+            }
+        }
+};
+
+/**
+ * @brief Check if a path is a directory
+ *
+ * @param path the path to check
+ *
+ * @return true the path is a directory
+ */
+bool isDirectory(const char* path) {
+    std::string filePath = path;
+    // if the path does not start with a slash, add one
+    if (filePath.find("/") != 0) filePath = "/" + filePath;
+    return filePath.c_str()[strlen(filePath.c_str()) - 1] == '/';
+}
+
+/**
+ * @brief Check if a path is a directory
+ *
+ * @param path the path to check
+ *
+ * @return true the path is a directory
+ */
+bool isDirectory(std::string path) { return isDirectory(path.c_str()); }
+
+/**
+ * @brief Rename or move a virtual file or directory
+ *
+ * Only the index is rewritten, the data of the files is not touched.
+ * If the old path is a directory, every file in it is moved in a single index update.
+ *
+ * @param oldPath the current path of the file or directory
+ * @param newPath the new path of the file or directory
+ */
+void renameFile(const char* oldPath, const char* newPath) {
+    lemlibLock lock;
+    std::string from = oldPath;
+    std::string to = newPath;
+    // if the paths do not start with a slash, add one
+    if (from.find("/") != 0) from = "/" + from;
+    if (to.find("/") != 0) to = "/" + to;
+    // a directory can only be moved to another directory
+    bool directory = isDirectory(from);
+    if (directory && !isDirectory(to)) to += "/";
+    // a file moved to a directory keeps its name
+    else if (!directory && to[to.length() - 1] == '/') to += from.substr(from.rfind('/') + 1);
+    // moves inside a top-level directory only read and write its part of the index
+    bool local = from.find("/", 1) != std::string::npos && getShardName(from) == getShardName(to);
+    std::vector<lemlibFile> index = local ? readShardIndex(from) : readFileIndex();
+    // rename the matching entries, and collect the names of the others
+    std::set<std::string> names;
+    std::vector<lemlibFile*> moved;
+    for (lemlibFile& file : index) {
+        if (directory ? file.name.find(from) == 0 : file.name == from) moved.push_back(&file);
+        else names.insert(file.name);
+    }
+    if (moved.size() == 0) throw fileNotFound;
+    for (lemlibFile* file : moved) {
+        file->name = to + file->name.substr(from.length());
+        // do not overwrite files that already exist
+        if (names.count(file->name)) throw fileAlreadyExists;
+    }
+    if (local) writeShardIndex(from, index);
+    else writeFileIndex(index);
+}
+
+/**
+ * @brief Rename or move a virtual file or directory
+ *
+ * @param oldPath the current path of the file or directory
+ * @param newPath the new path of the file or directory
+ */
+void renameFile(std::string oldPath, std::string newPath) { renameFile(oldPath.c_str(), newPath.c_str()); }
+
+/**
+ * @brief Copy a virtual file
+ *
+ * The copy shares the sector of the original file until either of them is written to.
+ *
+ * @param oldPath the path of the file to copy
+ * @param newPath the path of the copy
+ * @param overwrite whether to overwrite the copy if it already exists
+ */
+void copyFile(const char* oldPath, const char* newPath, bool overwrite = true) {
+    lemlibLock lock;
+    std::string from = oldPath;
+    std::string to = newPath;
+    // if the paths do not start with a slash, add one
+    if (from.find("/") != 0) from = "/" + from;
+    if (to.find("/") != 0) to = "/" + to;
+    if (from == to) return;
+    // find the original file
+    lemlibFile file = stat(from);
+    // Check if the copy already exists
+    if (fileExists(to)) {
+        // If the file should be overwritten, delete the file
+        if (overwrite) deleteFile(to);
+        // Otherwise, throw an exception
+        else throw fileAlreadyExists;
     }
-    return files;
+    // add the copy to the index, pointing to the same sector
+    file.name = to;
+    file.created = currentTime();
+    file.modified = file.created;
+    if (!(file.flags & FILE_FLAG_INLINE) && getShardName(from) != getShardName(to)) {
+        file.flags |= FILE_FLAG_SHARED;
+        markSectorShared(getShardName(from), file.sector);
+    }
+    appendShardEntry(file);
+    sharingGeneration++;
 }
 
 /**
- * @brief List all the files and folders in a directory
+ * @brief Copy a virtual file
  *
- * @param dir the directory to list
- * @return std::vector <std::string> a vector of all the files and folders in the directory
+ * @param oldPath the path of the file to copy
+ * @param newPath the path of the copy
+ * @param overwrite whether to overwrite the copy if it already exists
  */
-std::vector<std::string> listDirectory(std::string dir, bool recursive = false) {
-    return listDirectory(dir.c_str(), recursive);
+void copyFile(std::string oldPath, std::string newPath, bool overwrite = true) {
+    copyFile(oldPath.c_str(), newPath.c_str(), overwrite);
 }
 
 /**
- * @brief Check if a file exists
+ * @brief Delete a snapshot of the virtual file system
  *
- * @param path path of the file
- * @return true the file exists
- * @return false the file does not exist
+ * @param name the name of the snapshot
  */
-bool fileExists(const char* path) {
-    std::string filePath = path;
-    // if the path does not start with a slash, add one
-    if (filePath.find("/") != 0) filePath = "/" + filePath;
-    // Read the index file
-    std::vector<lemlibFile> index = readFileIndex();
-    // Iterate through the index
-    for (const lemlibFile& file : index) {
-        // Check if the name matches
-        if (file.name == filePath) return true;
+void deleteSnapshot(const char* name) {
+    lemlibLock lock;
+    readSnapshotReferences();
+    std::vector<std::string> snapshots = readSnapshotList();
+    std::vector<std::string> remaining;
+    for (const std::string& snapshot : snapshots) {
+        if (snapshot != name) remaining.push_back(snapshot);
     }
-    return false;
+    if (remaining.size() == snapshots.size()) throw fileNotFound;
+    std::vector<lemlibFile> snapshotIndex = readFileIndex(getSnapshotFile(name).c_str());
+    // remove the snapshot from the list
+    std::ofstream listFile;
+    listFile.open("snapshots.txt");
+    if (!listFile.is_open()) throw cannotOpenFile;
+    for (const std::string& snapshot : remaining) listFile << snapshot << std::endl;
+    listFile.close();
+    std::remove(getSnapshotFile(name).c_str());
+    countSnapshotReferences(snapshotIndex, -1);
+    // empty the sectors that were only used by the snapshot
+    std::map<std::string, int> references = getSectorReferences();
+    for (const lemlibFile& file : snapshotIndex) {
+        if (references.count(file.sector) == 0) freeSector(file.sector);
+    }
+    // the index on the SD card no longer uses them once every change is written
+    if (pendingChanges == 0) releaseFreedSectors();
 }
 
 /**
- * @brief Check if a file exists
+ * @brief Delete a snapshot of the virtual file system
  *
- * @param path path of the file
- * @return true the file exists
- * @return false the file does not exist
+ * @param name the name of the snapshot
  */
-bool fileExists(std::string path) { return fileExists(path.c_str()); }
+void deleteSnapshot(std::string name) { deleteSnapshot(name.c_str()); }
 
 /**
- * @brief delete a virtual file
+ * @brief Take a snapshot of the virtual file system
  *
- * @param path the path of the virtual file
+ * Only the index is copied. The snapshot shares the sectors of every file until they are
+ * written to, so taking a snapshot does not copy any file data.
+ *
+ * @param name the name of the snapshot, which is replaced if it already exists. It is part of a file
+ * name and a line of snapshots.txt, so it can not be empty or contain a slash, colon or whitespace
  */
-void deleteFile(const char* path) {
-    std::string filePath = path;
-    // if the path does not start with a slash, add one
-    if (filePath.find("/") != 0) filePath = "/" + filePath;
-    // check if the file exists
-    if (!fileExists(filePath)) throw fileNotFound;
-    // empty the sector the file is stored in
-    std::ofstream sector;
-    sector.open(getFileSector(filePath));
-    sector << "";
-    sector.close();
-    // remove the file from the index file
-    std::vector<lemlibFile> index = readFileIndex();
-    std::ofstream indexFile;
-    indexFile.open("index.txt");
-    if (!indexFile.is_open()) throw cannotOpenFile;
-    for (const lemlibFile& line : index) {
-        if (line.name != filePath) indexFile << line.name << "/" << line.sector << std::endl;
+void takeSnapshot(const char* name) {
+    lemlibLock lock;
+    std::string snapshotName = name;
+    if (snapshotName == "" || snapshotName.find_first_of("/: \t\r\n\v\f") != std::string::npos) throw cannotOpenFile;
+    readSnapshotReferences();
+    std::vector<std::string> snapshots = readSnapshotList();
+    bool found = false;
+    for (const std::string& snapshot : snapshots) {
+        if (snapshot == name) found = true;
     }
-    indexFile.close();
+    // replacing a snapshot releases the sectors only it was using
+    if (found) deleteSnapshot(name);
+    std::vector<lemlibFile> index = readFileIndex();
+    writeFileIndex(index, getSnapshotFile(name).c_str());
+    sharingGeneration++;
+    // add the snapshot to the list
+    std::ofstream listFile;
+    listFile.open("snapshots.txt", std::ios_base::app);
+    if (!listFile.is_open()) throw cannotOpenFile;
+    listFile << name << std::endl;
+    listFile.close();
+    countSnapshotReferences(index, 1);
 }
 
 /**
- * @brief delete a virtual file
+ * @brief Take a snapshot of the virtual file system
  *
- * @param path the path of the virtual file
+ * @param name the name of the snapshot, which is replaced if it already exists
  */
-void deleteFile(std::string path) { deleteFile(path.c_str()); }
+void takeSnapshot(std::string name) { takeSnapshot(name.c_str()); }
 
 /**
- * @brief Create a virtual file
+ * @brief Restore the virtual file system to a snapshot
  *
- * @param path the path of the virtual file
- * @return const char* the sector the file is stored in
+ * Only the index is replaced, so this takes the same time no matter how much data changed.
+ * The snapshot is kept, so it can be restored again.
+ *
+ * @param name the name of the snapshot
  */
-const char* createFile(const char* path, bool overwrite = true) {
-    std::string filePath = path;
-    // if the path does not start with a slash, add one
-    if (filePath.find("/") != 0) filePath = "/" + filePath;
-    // Create the file in the index file
-    std::ofstream indexFile;
-    indexFile.open("index.txt", std::ios_base::app);
-    if (!indexFile.is_open()) throw cannotOpenFile;
-    // Check if the file already exists
-    if (fileExists(filePath)) {
-        // If the file should be overwritten, delete the file
-        if (overwrite) deleteFile(filePath);
-        // Otherwise, throw an exception
-        else throw fileAlreadyExists;
+void restoreSnapshot(const char* name) {
+    lemlibLock lock;
+    bool found = false;
+    for (const std::string& snapshot : readSnapshotList()) {
+        if (snapshot == name) found = true;
     }
-    // Find the first empty sector
+    if (!found) throw fileNotFound;
     std::vector<lemlibFile> index = readFileIndex();
-    int sector = 0;
+    std::vector<lemlibFile> restored = readFileIndex(getSnapshotFile(name).c_str());
+    writeFileIndex(restored);
+    sharingGeneration++;
+    // empty the sectors that were only used by the discarded files
+    std::map<std::string, int> references = getSectorReferences();
     for (const lemlibFile& file : index) {
-        if (file.sector == to_string(sector)) sector++;
+        if (references.count(file.sector) == 0) freeSector(file.sector);
     }
-    // Create the file
-    indexFile << filePath << "/" << sector << std::endl;
-    indexFile.close();
-    // create the sector file
-    std::ofstream sectorFile;
-    // check if the sector file was created
-    if (!sectorFile.is_open()) throw cannotOpenFile;
-    sectorFile.open(to_string(sector));
-    sectorFile << "";
-    sectorFile.close();
-    return to_string(sector).c_str();
+    // the index on the SD card no longer uses them once every change is written
+    if (pendingChanges == 0) releaseFreedSectors();
 }
 
 /**
- * @brief Create a virtual file
+ * @brief Restore the virtual file system to a snapshot
  *
- * @param path the path of the virtual file
- * @return const char* the sector the file is stored in
+ * @param name the name of the snapshot
  */
-const char *createFile(std::string path, bool overwrite = true) { return createFile(path.c_str(), overwrite); }
+void restoreSnapshot(std::string name) { restoreSnapshot(name.c_str()); }
 
 /**
- * @brief Write data to a virtual file
+ * @brief Enable or disable compression of a file or directory
  *
- * @param path the path of the virtual file
- * @param data the data to write to the file, separated by \n
- * @return std::string the sector the file is stored in
+ * Compressing a file rewrites its sector. Compressing a directory compresses the files
+ * already in it, and every file created in it later.
+ *
+ * @param path the path of the file or directory
+ * @param enabled whether the data should be compressed
  */
-std::string write(const char* path, const char* data) {
+void setCompression(const char* path, bool enabled) {
+    lemlibLock lock;
     std::string filePath = path;
     // if the path does not start with a slash, add one
     if (filePath.find("/") != 0) filePath = "/" + filePath;
-    // Create the file if it does not exist
-    if (!fileExists(filePath)) createFile(filePath);
-
-    std::ofstream file;
-    file.open(getFileSector(filePath));
-    if (!file.is_open()) throw cannotOpenFile;
-    std::string line;
-    std::istringstream stream(data);
-    while (std::getline(stream, line, '\n')) file << line << std::endl;
-    file.close();
-
-    return getFileSector(filePath);
+    bool directory = isDirectory(filePath);
+    if (directory) {
+        // update the list of compressed directories
+        std::vector<std::string> directories = readCompressionList();
+        std::ofstream listFile;
+        listFile.open("compression.txt");
+        if (!listFile.is_open()) throw cannotOpenFile;
+        for (const std::string& line : directories) {
+            if (line != filePath) listFile << line << std::endl;
+        }
+        if (enabled) listFile << filePath << std::endl;
+        listFile.close();
+    }
+    // rewrite the sectors of the affected files
+    std::vector<lemlibFile> index = readFileIndex();
+    bool found = false;
+    for (lemlibFile& file : index) {
+        if (directory ? file.name.find(filePath) != 0 : file.name != filePath) continue;
+        found = true;
+        if (((file.flags & FILE_FLAG_COMPRESSED) != 0) == enabled) continue;
+        std::string contents = readFileData(file);
+        if (enabled) file.flags |= FILE_FLAG_COMPRESSED;
+        else file.flags &= ~FILE_FLAG_COMPRESSED;
+        storeFileData(index, &file, contents);
+    }
+    if (!found && !directory) throw fileNotFound;
+    writeFileIndex(index);
 }
 
 /**
- * @brief Write data to a virtual file
+ * @brief Enable or disable compression of a file or directory
  *
- * @param path the path of the virtual file
- * @param data the data to write to the file, separated by \n
- * @return std::string the sector the file is stored in
+ * @param path the path of the file or directory
+ * @param enabled whether the data should be compressed
  */
-std::string write(std::string path, std::string data) { return write(path.c_str(), data.c_str()); }
+void setCompression(std::string path, bool enabled) { setCompression(path.c_str(), enabled); }
 
 /**
- * @brief Read data from a virtual file
+ * @brief Print the throughput of a benchmark
  *
- * @param path the path of the virtual file
+ * @param name the name of the benchmark
+ * @param bytes the number of bytes processed
+ * @param time the time taken in microseconds
+ */
+void printThroughput(const std::string& name, unsigned long bytes, unsigned long long time) {
+    if (time == 0) time = 1;
+    std::cout << name << ": " << (double)bytes / time << " MB/s" << std::endl;
+}
+
+/**
+ * @brief Compare the throughput of the compression codec to reading and writing sectors
  *
- * @return std::string the data in the file, separated by \n
+ * @param data the data to benchmark with
  */
-std::string read(const char* path) {
-    std::string filePath = path;
-    // if the path does not start with a slash, add one
-    if (filePath.find("/") != 0) filePath = "/" + filePath;
-    // Check if it exists
-    if (!fileExists(filePath)) throw fileNotFound;
+void benchmarkCompression(const std::string& data) {
+    unsigned long long start = microseconds();
+    std::string compressed = compressData(data);
+    printThroughput("Compress", data.length(), microseconds() - start);
 
-    // Find the file
-    std::ifstream file;
-    file.open(getFileSector(filePath));
-    if (!file.is_open()) throw cannotOpenFile;
-    // Read the contents, line by line
-    std::string data = "";
-    std::string line;
-    while (std::getline(file, line)) data += line + "\n";
-    file.close();
+    start = microseconds();
+    std::string decompressed = decompressData(compressed);
+    printThroughput("Decompress", data.length(), microseconds() - start);
+    if (decompressed != data) throw corruptFile;
 
-    return data;
+    // write and read a scratch sector without and with compression
+    start = microseconds();
+    std::ofstream out;
+    out.open(getSectorFile("benchmark").c_str(), std::ios_base::binary);
+    if (!out.is_open()) throw cannotOpenFile;
+    out << data;
+    out.close();
+    printThroughput("Raw write", data.length(), microseconds() - start);
+
+    start = microseconds();
+    std::string raw = readSector("benchmark");
+    printThroughput("Raw read", data.length(), microseconds() - start);
+
+    start = microseconds();
+    out.open(getSectorFile("benchmark").c_str(), std::ios_base::binary);
+    if (!out.is_open()) throw cannotOpenFile;
+    out << compressData(data);
+    out.close();
+    printThroughput("Compressed write", data.length(), microseconds() - start);
+
+    start = microseconds();
+    raw = decompressData(readSector("benchmark"));
+    printThroughput("Compressed read", data.length(), microseconds() - start);
+
+    std::cout << "Ratio: " << (double)data.length() / compressed.length() << std::endl;
+    std::remove(getSectorFile("benchmark").c_str());
 }
 
 /**
- * @brief Read data from a virtual file
- *
- * @param path the path of the virtual file
+ * @brief Compare number formatting and parsing to streams
  *
- * @return std::string the data in the file, separated by \n
+ * @param count the number of values to convert
  */
-std::string read(std::string path) { return read(path.c_str()); }
+void benchmarkFloat(int count) {
+    std::vector<double> values;
+    for (int i = 0; i < count; i++) values.push_back((i % 2000) * 0.0125 - 12.5 + (i / 2000) * 0.001);
+
+    unsigned long long start = microseconds();
+    std::ostringstream stream;
+    for (double value : values) stream << value << "\n";
+    std::string streamText = stream.str();
+    unsigned long long streamFormat = microseconds() - start;
+
+    start = microseconds();
+    std::string text;
+    for (double value : values) text += to_string(value) + "\n";
+    unsigned long long fastFormat = microseconds() - start;
+
+    start = microseconds();
+    std::istringstream input(text);
+    double sum = 0;
+    for (double value; input >> value;) sum += value;
+    unsigned long long streamParse = microseconds() - start;
+
+    start = microseconds();
+    const char* pos = text.c_str();
+    size_t parsed = 0;
+    for (const char* end; *pos != '\0'; pos = end + 1) {
+        if (parseDouble(pos, &end) == values[parsed]) parsed++;
+    }
+    unsigned long long fastParse = microseconds() - start;
+
+    std::cout << "Stream format: " << streamFormat << " us" << std::endl;
+    std::cout << "Fast format: " << fastFormat << " us" << std::endl;
+    std::cout << "Stream parse: " << streamParse << " us" << std::endl;
+    std::cout << "Fast parse: " << fastParse << " us" << std::endl;
+    std::cout << "Round trips: " << parsed << "/" << count << std::endl;
+}
 
 /**
- * @brief Check if a path is a directory
+ * @brief Compare looking up files in the sorted index to searching a vector of entries
  *
- * @param path the path to check
+ * @param count the number of files in the index
+ */
+void benchmarkIndex(int count) {
+    std::vector<lemlibFile> index;
+    for (int i = 0; i < count; i++) {
+        lemlibFile file = {};
+        file.name = "/logs/run" + to_string(i / 100) + "/sensor" + to_string(i % 100) + ".bin";
+        file.sector = to_string(i);
+        file.size = i;
+        index.push_back(file);
+    }
+    lemlibSortedIndex sorted;
+    sorted.build(index);
+    // look up every file, in a different order than they were added
+    std::vector<std::string> paths;
+    for (int i = 0; i < count; i++) paths.push_back(index[(i * 7919) % count].name);
+
+    unsigned long long start = microseconds();
+    size_t found = 0;
+    for (const std::string& path : paths) {
+        for (const lemlibFile& file : index) {
+            if (file.name == path) {
+                found++;
+                break;
+            }
+        }
+    }
+    unsigned long long vectorTime = microseconds() - start;
+
+    start = microseconds();
+    size_t sortedFound = 0;
+    lemlibFile file = {};
+    for (const std::string& path : paths) sortedFound += sorted.find(path, file);
+    unsigned long long sortedTime = microseconds() - start;
+
+    size_t vectorMemory = index.capacity() * sizeof(lemlibFile);
+    for (const lemlibFile& entry : index) vectorMemory += entry.name.capacity() + entry.sector.capacity();
+
+    std::cout << "Vector lookup: " << vectorTime << " us, " << vectorMemory << " bytes, " << found << " found"
+              << std::endl;
+    std::cout << "Sorted index lookup: " << sortedTime << " us, " << sorted.memoryUsage() << " bytes, "
+              << sortedFound << " found" << std::endl;
+}
+
+/**
+ * @brief Compare parsing the index file line by line, in one pass, and split between every core
  *
- * @return true the path is a directory
+ * @param count the number of files in the index
  */
-bool isDirectory(const char* path) {
-    std::string filePath = path;
-    // if the path does not start with a slash, add one
-    if (filePath.find("/") != 0) filePath = "/" + filePath;
-    return filePath.c_str()[strlen(filePath.c_str()) - 1] == '/';
+void benchmarkParse(int count) {
+    std::string text;
+    for (int i = 0; i < count; i++) {
+        lemlibFile file = {};
+        file.name = "/robot" + to_string(i / 10000) + "/logs/run" + to_string(i / 100 % 100) + "/sensor" +
+                    to_string(i % 100) + ".bin";
+        file.sector = to_string(i);
+        file.size = i;
+        text += formatIndexEntry(file) + "\n";
+    }
+
+    unsigned long long start = microseconds();
+    std::vector<lemlibFile> lines;
+    std::istringstream stream(text);
+    for (std::string line; std::getline(stream, line);) lines.push_back(parseIndexEntry(line));
+    printThroughput("Line by line parse", text.length(), microseconds() - start);
+
+    start = microseconds();
+    std::vector<lemlibFile> parsed;
+    parseFileIndex(text.c_str(), text.length(), parsed);
+    printThroughput("One pass parse", text.length(), microseconds() - start);
+
+    start = microseconds();
+    std::vector<lemlibFile> parallel;
+    parseFileIndex(text, parallel);
+    printThroughput("Parse on " + to_string(getCoreCount()) + " cores", text.length(), microseconds() - start);
+
+    start = microseconds();
+    size_t delimiters = 0;
+    for (size_t block = 0; block + 64 <= text.length(); block += 64) {
+        delimiters += __builtin_popcountll(getDelimiterMask(text.c_str() + block));
+    }
+    printThroughput("Delimiter search", text.length(), microseconds() - start);
+    std::cout << "Parsed " << parsed.size() << " entries, " << delimiters << " delimiters" << std::endl;
 }
 
 /**
- * @brief Check if a path is a directory
+ * @brief Check that a lazy mount followed by a write only reads the directory that was written to
  *
- * @param path the path to check
+ * The files are written under /benchmark0 to /benchmarkN, and deleted afterwards.
  *
- * @return true the path is a directory
+ * @param directories the number of top-level directories
+ * @param files the number of files in each directory
  */
-bool isDirectory(std::string path) { return isDirectory(path.c_str()); }
+void benchmarkMount(int directories, int files) {
+    for (int i = 0; i < directories; i++) {
+        for (int j = 0; j < files; j++) {
+            std::string path = "/benchmark" + to_string(i) + "/file" + to_string(j);
+            write(path.c_str(), std::string(64, 'a' + i % 26).c_str());
+        }
+    }
+
+    unsigned long long start = microseconds();
+    initVFS(true);
+    unsigned long long mountTime = microseconds() - start;
+
+    start = microseconds();
+    write("/benchmark0/new", std::string(64, 'n').c_str());
+    unsigned long long writeTime = microseconds() - start;
+
+    int loaded = 0;
+    for (std::pair<const std::string, lemlibShard>& shard : shards) {
+        if (shard.first.compare(0, 9, "benchmark") == 0 && shard.second.index.isLoaded()) loaded++;
+    }
+    std::cout << "Lazy mount: " << mountTime << " us" << std::endl;
+    std::cout << "First write: " << writeTime << " us" << std::endl;
+    std::cout << "Directories read: " << loaded << "/" << directories << std::endl;
+    std::cout << "Other directories untouched: " << (loaded == 1 ? "yes" : "no") << std::endl;
+
+    deleteFile("/benchmark0/new");
+    for (int i = 0; i < directories; i++) {
+        for (int j = 0; j < files; j++) deleteFile(("/benchmark" + to_string(i) + "/file" + to_string(j)).c_str());
+    }
+}
 
 /**
  * @brief Initializes the listeners for the extension and
@@ -413,6 +5486,18 @@ void initializeSerialListener() {
             std::cout << "Name | Sector" << std::endl;
 
             for (const lemlibFile& line : index) { std::cout << line.name << " | " << line.sector << std::endl; }
+
+            // only the parts of the index that have been used are in memory
+            size_t entries = 0;
+            size_t memory = 0;
+            for (std::pair<const std::string, lemlibShard>& shard : shards) {
+                entries += shard.second.index.size();
+                memory += shard.second.index.memoryUsage();
+            }
+            std::cout << std::endl;
+            std::cout << "Directories: " << readShardList().size() << ", " << shards.size() << " loaded" << std::endl;
+            std::cout << "Entries: " << entries << std::endl;
+            std::cout << "Memory: " << memory << " bytes" << std::endl;
         } else if (command == "sector") {
             if (args.size() == 0) {
                 std::cout << "Usage: sector <path>" << std::endl;
@@ -422,6 +5507,23 @@ void initializeSerialListener() {
             std::string name = args[0].c_str();
 
             std::cout << "Location of sector " + name + ": " << getFileSector(name.c_str()) << std::endl;
+        } else if (command == "stat") {
+            if (args.size() == 0) {
+                std::cout << "Usage: stat <path>" << std::endl;
+                continue;
+            }
+
+            std::string path = args[0].c_str();
+
+            lemlibFile file = stat(path.c_str());
+
+            std::cout << "Stat of file " + path + ":" << std::endl;
+            std::cout << "-----------------------" << std::endl;
+            std::cout << "Sector: " << file.sector << std::endl;
+            std::cout << "Size: " << file.size << std::endl;
+            std::cout << "Created: " << file.created << std::endl;
+            std::cout << "Modified: " << file.modified << std::endl;
+            std::cout << "Flags: " << file.flags << std::endl;
         } else if (command == "ls") {
             if (args.size() == 0) {
                 std::cout << "Usage: ls <path> [recursive]" << std::endl;
@@ -469,7 +5571,7 @@ void initializeSerialListener() {
             std::cout << "Deleted file " + path << std::endl;
         } else if (command == "create") {
             if (args.size() == 0) {
-                std::cout << "Usage: create <path> [override]" << std::endl;
+                std::cout << "Usage: create <path> [override] [size]" << std::endl;
                 continue;
             }
 
@@ -480,9 +5582,117 @@ void initializeSerialListener() {
             if (args.size() > 1)
                 if (args[1] == "true") override = true;
 
-            createFile(path.c_str(), override);
+            createFile(path.c_str(), override, args.size() > 2 ? strtoul(args[2].c_str(), NULL, 10) : 0);
 
             std::cout << "Created file " + path << std::endl;
+        } else if (command == "reserve") {
+            if (args.size() < 2) {
+                std::cout << "Usage: reserve <path> <bytes>" << std::endl;
+                continue;
+            }
+
+            std::string path = args[0].c_str();
+
+            reserve(path.c_str(), strtoul(args[1].c_str(), NULL, 10));
+
+            std::cout << "Reserved " + args[1] + " bytes for file " + path << std::endl;
+        } else if (command == "rename") {
+            if (args.size() < 2) {
+                std::cout << "Usage: rename <path> <new path>" << std::endl;
+                continue;
+            }
+
+            std::string path = args[0].c_str();
+            std::string newPath = args[1].c_str();
+
+            renameFile(path.c_str(), newPath.c_str());
+
+            std::cout << "Renamed " + path + " to " + newPath << std::endl;
+        } else if (command == "copy") {
+            if (args.size() < 2) {
+                std::cout << "Usage: copy <path> <new path>" << std::endl;
+                continue;
+            }
+
+            std::string path = args[0].c_str();
+            std::string newPath = args[1].c_str();
+
+            copyFile(path.c_str(), newPath.c_str());
+
+            std::cout << "Copied " + path + " to " + newPath << std::endl;
+        } else if (command == "snapshot") {
+            if (args.size() < 2) {
+                std::cout << "Usage: snapshot <take|restore|delete> <name>" << std::endl;
+                continue;
+            }
+
+            std::string name = args[1].c_str();
+
+            if (args[0] == "take") {
+                takeSnapshot(name.c_str());
+                std::cout << "Took snapshot " + name << std::endl;
+            } else if (args[0] == "restore") {
+                restoreSnapshot(name.c_str());
+                std::cout << "Restored snapshot " + name << std::endl;
+            } else if (args[0] == "delete") {
+                deleteSnapshot(name.c_str());
+                std::cout << "Deleted snapshot " + name << std::endl;
+            } else {
+                std::cout << "Usage: snapshot <take|restore|delete> <name>" << std::endl;
+            }
+        } else if (command == "snapshots") {
+            std::cout << "Snapshots" << std::endl;
+            std::cout << "-----------------------" << std::endl;
+
+            for (const std::string& snapshot : readSnapshotList()) std::cout << snapshot << std::endl;
+        } else if (command == "dedup") {
+            if (args.size() == 0) {
+                std::cout << "Usage: dedup <on|off>" << std::endl;
+                continue;
+            }
+
+            deduplicate = args[0] == "on";
+
+            std::cout << "Deduplication " + std::string(deduplicate ? "enabled" : "disabled") << std::endl;
+        } else if (command == "durability") {
+            if (args.size() == 0) {
+                std::cout << "Usage: durability <immediate|group|sync> [interval] [changes]" << std::endl;
+                continue;
+            }
+
+            int level = DURABILITY_IMMEDIATE;
+            if (args[0] == "group") level = DURABILITY_GROUP;
+            else if (args[0] == "sync") level = DURABILITY_SYNC;
+
+            setDurability(level, args.size() > 1 ? strtoul(args[1].c_str(), NULL, 10) : 100,
+                          args.size() > 2 ? strtoul(args[2].c_str(), NULL, 10) : 16);
+
+            std::cout << "Durability set to " + args[0] << std::endl;
+        } else if (command == "pool") {
+            if (args.size() == 0) {
+                std::cout << "Usage: pool <size>" << std::endl;
+                continue;
+            }
+
+            setSectorPool(strtoul(args[0].c_str(), NULL, 10));
+
+            std::cout << "Sector pool size set to " + args[0] << std::endl;
+        } else if (command == "sync") {
+            syncIndex();
+
+            std::cout << "Index written" << std::endl;
+        } else if (command == "compress") {
+            if (args.size() < 2) {
+                std::cout << "Usage: compress <path> <on|off>" << std::endl;
+                continue;
+            }
+
+            std::string path = args[0].c_str();
+
+            setCompression(path.c_str(), args[1] == "on");
+
+            std::cout << "Compression of " + path + " " + std::string(args[1] == "on" ? "enabled" : "disabled")
+                      << std::endl;
         } else if (command == "write") {
             if (args.size() == 0) {
                 std::cout << "Usage: write <path> <data>" << std::endl;
@@ -513,20 +5723,109 @@ void initializeSerialListener() {
             std::cout << "Data in file " + path + ":" << std::endl;
             std::cout << "-----------------------" << std::endl;
             std::cout << data << std::endl;
+        } else if (command == "readat") {
+            if (args.size() < 3) {
+                std::cout << "Usage: readat <path> <offset> <length>" << std::endl;
+                continue;
+            }
+
+            std::string path = args[0].c_str();
+
+            std::string data = readAt(path.c_str(), strtoul(args[1].c_str(), NULL, 10),
+                                      strtoul(args[2].c_str(), NULL, 10));
+
+            std::cout << "Data in file " + path + ":" << std::endl;
+            std::cout << "-----------------------" << std::endl;
+            std::cout << data << std::endl;
+        } else if (command == "records") {
+            if (args.size() == 0) {
+                std::cout << "Usage: records <path>" << std::endl;
+                continue;
+            }
+
+            std::string path = args[0].c_str();
+
+            std::vector<std::string> records = readRecordFileAsText(path.c_str());
+
+            std::cout << "Records in file " + path + ":" << std::endl;
+            std::cout << "-----------------------" << std::endl;
+
+            for (const std::string& record : records) std::cout << record << std::endl;
+        } else if (command == "column") {
+            if (args.size() < 2) {
+                std::cout << "Usage: column <path> <name>" << std::endl;
+                continue;
+            }
+
+            std::string path = args[0].c_str();
+
+            std::vector<double> values = readColumn(path.c_str(), args[1].c_str());
+
+            std::cout << "Column " + args[1] + " in file " + path + ":" << std::endl;
+            std::cout << "-----------------------" << std::endl;
+
+            for (double value : values) std::cout << to_string(value) << std::endl;
+        } else if (command == "bench") {
+            if (args.size() == 0) {
+                std::cout << "Usage: bench <compression|float|index|parse|mount> [path]" << std::endl;
+                continue;
+            }
+
+            if (args[0] == "compression") {
+                std::string data;
+                if (args.size() > 1) data = read(args[1].c_str());
+                // without a file, benchmark with generated telemetry
+                else {
+                    for (int i = 0; i < 20000; i++) {
+                        data += to_string(i * 10) + "," + to_string(i % 700) + "." + to_string(i % 97) + "," +
+                                to_string(1000 - i % 1000) + ".25," + to_string(i % 360) + "\n";
+                    }
+                }
+                benchmarkCompression(data);
+            } else if (args[0] == "float") {
+                benchmarkFloat(100000);
+            } else if (args[0] == "index") {
+                benchmarkIndex(2000);
+            } else if (args[0] == "parse") {
+                benchmarkParse(100000);
+            } else if (args[0] == "mount") {
+                benchmarkMount(16, 100);
+            } else {
+                std::cout << "Unknown benchmark" << std::endl;
+            }
         } else if (command == "help") {
             std::cout << "Available commands:" << std::endl;
             std::cout << "-----------------------" << std::endl;
             std::cout << "index" << std::endl;
             std::cout << "sector <path>" << std::endl;
+            std::cout << "stat <path>" << std::endl;
             std::cout << "ls <path> [recursive]" << std::endl;
             std::cout << "exists <path>" << std::endl;
             std::cout << "delete <path>" << std::endl;
-            std::cout << "create <path> [override]" << std::endl;
+            std::cout << "create <path> [override] [size]" << std::endl;
+            std::cout << "reserve <path> <bytes>" << std::endl;
+            std::cout << "rename <path> <new path>" << std::endl;
+            std::cout << "copy <path> <new path>" << std::endl;
+            std::cout << "snapshot <take|restore|delete> <name>" << std::endl;
+            std::cout << "snapshots" << std::endl;
+            std::cout << "dedup <on|off>" << std::endl;
+            std::cout << "durability <immediate|group|sync> [interval] [changes]" << std::endl;
+            std::cout << "sync" << std::endl;
+            std::cout << "pool <size>" << std::endl;
             std::cout << "write <path> <data>" << std::endl;
             std::cout << "read <path>" << std::endl;
+            std::cout << "readat <path> <offset> <length>" << std::endl;
+            std::cout << "records <path>" << std::endl;
+            std::cout << "column <path> <name>" << std::endl;
+            std::cout << "compress <path> <on|off>" << std::endl;
+            std::cout << "bench <compression|float|index|parse|mount> [path]" << std::endl;
             std::cout << "help" << std::endl;
             std::cout << "exit" << std::endl;
         } else if (command == "exit") {
+            // write the changes that are still in memory, and stop the background tasks
+            setDurability(DURABILITY_IMMEDIATE);
+            setSectorPool(0);
+
             std::cout << std::endl;
             std::cout << "Exiting..." << std::endl;
             break;
@@ -544,8 +5843,8 @@ void initializeSerialListener() {
  * @return int program exit code
  */
 int main() {
-    // Initialize the file system
-    initVFS();
+    // Initialize the file system, reading the index when it is first used
+    initVFS(true);
     std::cout << "[INIT] Initialized" << std::endl;
 
     initializeSerialListener();